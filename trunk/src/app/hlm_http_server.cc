@@ -1,9 +1,10 @@
 #include "hlm_http_server.h"
 
+#include <filesystem>
 #include <iostream>
 #include <string>
 
-HlmHttpServer::HlmHttpServer(int max_tasks) : task_manager_(max_tasks) {
+HlmHttpServer::HlmHttpServer(const TaskConfig& task_config) : task_manager_(task_config) {
     initRoutes();
     setLogLevel(LogLevel::Warning);
 }
@@ -15,6 +16,14 @@ void HlmHttpServer::initRoutes() {
         });
     });
 
+    // 响应体是图片数据，只记录大小，不经过 logWrapper 打印
+    CROW_ROUTE(app_, "/screenshot/archive").methods(HTTPMethod::Get)([this](const request& req) {
+        hlm_info("Received request url:{}", req.raw_url);
+        response res = getArchivedScreenshot(req);
+        hlm_info("Response url:{}, code:{}, size:{}", req.raw_url, res.code, res.body.size());
+        return res;
+    });
+
     CROW_ROUTE(app_, "/recording").methods(HTTPMethod::Post)([this](const request& req) {
         return logWrapper(req, [this](const request& req) {
             return manageRecordingReq(req);
@@ -26,6 +35,18 @@ void HlmHttpServer::initRoutes() {
             return manageMixReq(req);
         });
     });
+
+    CROW_ROUTE(app_, "/ingest").methods(HTTPMethod::Post)([this](const request& req) {
+        return logWrapper(req, [this](const request& req) {
+            return manageIngestReq(req);
+        });
+    });
+
+    CROW_ROUTE(app_, "/task/status").methods(HTTPMethod::Get)([this](const request& req) {
+        return logWrapper(req, [this](const request& req) {
+            return getTaskStatus();
+        });
+    });
 }
 
 void HlmHttpServer::start(int port) {
@@ -67,11 +88,11 @@ response HlmHttpServer::startScreenshot(const json::rvalue& body) {
 
     // 按时间间隔截图(interval)方式：支持实时流和文件
     // 立即截图(immediate)方式：只支持实时流
-    // 按百分比截图(percentage)和指定时间点截图(specific_time)方式：只支持文件
+    // 按百分比截图(percentage)、指定时间点截图(specific_time)和雪碧图(storyboard)方式：只支持文件
     bool isRtmpStream = (stream_url.find("rtmp://") == 0);
-    if (method == HlmScreenshotMethod::Percentage || method == HlmScreenshotMethod::SpecificTime) {
+    if (method == HlmScreenshotMethod::Percentage || method == HlmScreenshotMethod::SpecificTime || method == HlmScreenshotMethod::Storyboard) {
         if (isRtmpStream) {
-            return createJsonResponse(INVALID_REQUEST, "Percentage and specific time screenshot are not supported for streams.");
+            return createJsonResponse(INVALID_REQUEST, "Percentage, specific time and storyboard screenshot are not supported for streams.");
         }
     } else if (method == HlmScreenshotMethod::Immediate) {
         if (!isRtmpStream) {
@@ -82,14 +103,26 @@ response HlmHttpServer::startScreenshot(const json::rvalue& body) {
     try {
         auto strategy = HlmScreenshotStrategyFactory::createStrategy(method);
         auto task = strategy->createTask(stream_url, method, output_dir, filename_prefix, body);
+        task->setMediaProfile(parseMediaProfile(body));
+        task->setDecoderThreading(parseDecoderThreading(body));
+        auto screenshot_task = static_pointer_cast<HlmScreenshotTask>(task);
+        response cached;
+        if (serveCachedScreenshot(screenshot_task, cached)) {
+            return cached;
+        }
+        if (screenshot_task->isInlineOutput()) {
+            return captureInlineScreenshot(screenshot_task);
+        }
+        // 输出文件名可预知的截图方式在响应中返回文件列表
+        vector<string> files = screenshot_task->outputFiles();
         HlmTaskAddStatus status = task_manager_.addTask(task, stream_url, method);
         switch (status) {
             case HlmTaskAddStatus::TaskAlreadyRunning:
                 return createJsonResponse(INVALID_REQUEST, "A screenshot task with the same stream URL and method is already running.");
             case HlmTaskAddStatus::TaskQueued:
-                return createJsonResponse(QUEUED, "Task queued, waiting for execution.");
+                return createJsonResponse(QUEUED, "Task queued, waiting for execution.", files);
             case HlmTaskAddStatus::TaskStarted:
-                return createJsonResponse(SUCCESS, "Screenshot task started.");
+                return createJsonResponse(SUCCESS, "Screenshot task started.", files);
             case HlmTaskAddStatus::QueueFull:
                 return createJsonResponse(INVALID_REQUEST, "Task queue is full, unable to add task.");
         }
@@ -111,6 +144,83 @@ response HlmHttpServer::stopScreenshot(const json::rvalue& body) {
     }
 }
 
+bool HlmHttpServer::serveCachedScreenshot(shared_ptr<HlmScreenshotTask> task, response& resp) {
+    vector<string> keys = task->cacheKeys();
+    if (keys.empty()) {
+        return false;
+    }
+
+    // 所有输出图片都命中时直接返回，不创建任务
+    vector<shared_ptr<const string>> images;
+    for (const auto& key : keys) {
+        shared_ptr<const string> image;
+        if (!HlmScreenshotCache::getInstance().get(key, image)) {
+            return false;
+        }
+        images.push_back(image);
+    }
+
+    if (task->isInlineOutput()) {
+        resp = response(200, *images[0]);
+        resp.set_header("Content-Type", HlmScreenshotArchiveReader::detectContentType(*images[0]));
+        return true;
+    }
+
+    vector<string> files = task->outputFiles();
+    std::error_code ec;
+    filesystem::create_directories(filesystem::path(files[0]).parent_path(), ec);
+    for (size_t i = 0; i < files.size() && i < images.size(); i++) {
+        HlmScreenshotCache::getInstance().writeFile(files[i], images[i]);
+    }
+    resp = createJsonResponse(SUCCESS, "Screenshot served from cache.", files);
+    return true;
+}
+
+response HlmHttpServer::captureInlineScreenshot(shared_ptr<HlmScreenshotTask> task) {
+    // 同步截图在当前 HTTP 工作线程中执行，不进入任务队列，图片不写文件
+    task->execute();
+    HlmInlineImage image;
+    if (!task->takeInlineImage(image)) {
+        return createJsonResponse(INVALID_REQUEST, "Failed to capture screenshot.");
+    }
+
+    // 响应体直接由编码输出数据构造，只有这一次复制
+    response resp(200);
+    resp.body.assign(reinterpret_cast<const char*>(image.data), image.size);
+    av_buffer_unref(&image.buffer);
+    resp.set_header("Content-Type", HlmScreenshotArchiveReader::detectContentType(resp.body));
+    return resp;
+}
+
+response HlmHttpServer::getArchivedScreenshot(const request& req) {
+    const char* output_dir = req.url_params.get("output_dir");
+    const char* filename_prefix = req.url_params.get("filename_prefix");
+    const char* index = req.url_params.get("index");
+    const char* timestamp = req.url_params.get("timestamp");
+    const char* width = req.url_params.get("width");
+    if (!output_dir || !filename_prefix || (!index && !timestamp)) {
+        return createJsonResponse(INVALID_REQUEST, "output_dir, filename_prefix and one of index or timestamp are required.");
+    }
+
+    // 按序号或媒体时间（秒）读取归档中的单张截图
+    string image;
+    bool found = false;
+    try {
+        HlmScreenshotArchiveReader reader(output_dir, filename_prefix);
+        int image_width = width ? stoi(width) : -1;
+        found = index ? reader.readByIndex(stoi(index), image_width, image) : reader.readByTimestamp(stod(timestamp), image_width, image);
+    } catch (const logic_error&) {
+        return createJsonResponse(INVALID_REQUEST, "index, timestamp and width must be numbers.");
+    }
+    if (!found) {
+        return createJsonResponse(INVALID_REQUEST, "Screenshot not found in archive.");
+    }
+
+    response resp(200, image);
+    resp.set_header("Content-Type", HlmScreenshotArchiveReader::detectContentType(image));
+    return resp;
+}
+
 response HlmHttpServer::manageRecordingReq(const request& req) {
     auto body = json::load(req.body);
     if (!body) {
@@ -142,6 +252,9 @@ response HlmHttpServer::startRecording(const json::rvalue& body) {
     if (!(filename.size() >= 4 && (filename.substr(filename.size() - 4) == ".mp4" || filename.substr(filename.size() - 5) == ".m3u8"))) {
         return createJsonResponse(INVALID_REQUEST, "Filename must end with .mp4 or .m3u8.");
     }
+    if (method == HlmRecordingMethod::Fmp4 && filename.substr(filename.size() - 4) != ".mp4") {
+        return createJsonResponse(INVALID_REQUEST, "Fragmented MP4 recording requires a .mp4 filename.");
+    }
 
     // 录制成HLS和MP4：只支持实时流
     bool isRtmpStream = (stream_url.find("rtmp://") == 0);
@@ -327,10 +440,147 @@ vector<HlmStreamInfo> HlmHttpServer::parseStreams(const json::rvalue& streams_js
     return streams;
 }
 
+response HlmHttpServer::manageIngestReq(const request& req) {
+    auto body = json::load(req.body);
+    if (!body) {
+        return createJsonResponse(INVALID_JSON, "Invalid JSON");
+    }
+
+    map<string, string> errors;
+    vector<string> required_fields = {"stream_url", "action"};
+    if (!validateJson(body, required_fields, errors)) {
+        return createJsonResponse(INVALID_REQUEST, "Missing fields: " + errors.begin()->second);
+    }
+
+    // 常驻流保持拉流并缓存当前 GOP，之后的立即截图直接从缓存解码
+    string stream_url = body["stream_url"].s();
+    string action = body["action"].s();
+    if (stream_url.find("rtmp://") != 0) {
+        return createJsonResponse(INVALID_REQUEST, "Pinning is only supported for RTMP streams.");
+    }
+    if (action == HlmTaskAction::Pin) {
+        if (!HlmIngestManager::getInstance().pin(stream_url)) {
+            return createJsonResponse(INVALID_REQUEST, "Failed to open stream.");
+        }
+        return createJsonResponse(SUCCESS, "Stream pinned.");
+    } else if (action == HlmTaskAction::Unpin) {
+        if (!HlmIngestManager::getInstance().unpin(stream_url)) {
+            return createJsonResponse(INVALID_REQUEST, "Stream is not pinned.");
+        }
+        return createJsonResponse(SUCCESS, "Stream unpinned.");
+    } else {
+        return createJsonResponse(INVALID_REQUEST, "Invalid action. Valid actions are 'pin' or 'unpin'.");
+    }
+}
+
+response HlmHttpServer::getTaskStatus() {
+    HlmTaskBudgetUsage usage = task_manager_.getBudgetUsage();
+    HlmThreadPoolStats worker_stats = task_manager_.getWorkerStats();
+
+    json::wvalue jsonResp;
+    jsonResp["code"] = SUCCESS;
+    jsonResp["message"] = "OK";
+    jsonResp["data"]["cpu_used"] = usage.cpu_used;
+    jsonResp["data"]["cpu_budget"] = usage.cpu_budget;
+    jsonResp["data"]["memory_used_mb"] = usage.memory_used_mb;
+    jsonResp["data"]["memory_budget_mb"] = usage.memory_budget_mb;
+    jsonResp["data"]["active_tasks"] = usage.active_tasks;
+    jsonResp["data"]["queued_tasks"] = usage.queued_tasks;
+    jsonResp["data"]["max_tasks"] = usage.max_tasks;
+    jsonResp["data"]["workers"]["total"] = worker_stats.workers;
+    jsonResp["data"]["workers"]["busy"] = worker_stats.busy_workers;
+    jsonResp["data"]["workers"]["queued_jobs"] = worker_stats.queued_jobs;
+    jsonResp["data"]["workers"]["started_jobs"] = worker_stats.started_jobs;
+    jsonResp["data"]["workers"]["last_wait_us"] = worker_stats.last_wait_us;
+    jsonResp["data"]["workers"]["avg_wait_us"] = worker_stats.avg_wait_us;
+    jsonResp["data"]["workers"]["max_wait_us"] = worker_stats.max_wait_us;
+
+    HlmFileWriterStats writer_stats = HlmFileWriter::getInstance().getStats();
+    jsonResp["data"]["writer"]["workers"] = writer_stats.workers;
+    jsonResp["data"]["writer"]["submitted_writes"] = writer_stats.submitted_writes;
+    jsonResp["data"]["writer"]["completed_writes"] = writer_stats.completed_writes;
+    jsonResp["data"]["writer"]["failed_writes"] = writer_stats.failed_writes;
+    jsonResp["data"]["writer"]["dropped_writes"] = writer_stats.dropped_writes;
+    jsonResp["data"]["writer"]["write_syscalls"] = writer_stats.write_syscalls;
+    jsonResp["data"]["writer"]["pending_bytes"] = writer_stats.pending_bytes;
+    for (size_t i = 0; i < writer_stats.latency_histogram.size(); i++) {
+        jsonResp["data"]["writer"]["latency_histogram"][HlmFileWriter::latencyBucketLabel(i)] = writer_stats.latency_histogram[i];
+    }
+    jsonResp["data"]["pinned_streams"] = HlmIngestManager::getInstance().getPinnedStreams();
+
+    HlmInputPoolStats input_pool_stats = HlmInputPool::getInstance().getStats();
+    jsonResp["data"]["input_pool"]["hits"] = input_pool_stats.hits;
+    jsonResp["data"]["input_pool"]["misses"] = input_pool_stats.misses;
+    jsonResp["data"]["input_pool"]["expired"] = input_pool_stats.expired;
+    jsonResp["data"]["input_pool"]["idle"] = input_pool_stats.idle;
+
+    // 平均探测耗时用于对比命中缓存前后的任务启动延迟
+    HlmProbeStats probe_stats = HlmProbeCache::getInstance().getStats();
+    jsonResp["data"]["probe"]["hits"] = probe_stats.hits;
+    jsonResp["data"]["probe"]["misses"] = probe_stats.misses;
+    jsonResp["data"]["probe"]["stale"] = probe_stats.stale;
+    jsonResp["data"]["probe"]["entries"] = probe_stats.entries;
+    jsonResp["data"]["probe"]["avg_hit_probe_ms"] = probe_stats.hits > 0 ? probe_stats.hit_probe_us / 1000.0 / probe_stats.hits : 0.0;
+    jsonResp["data"]["probe"]["avg_full_probe_ms"] = probe_stats.misses > 0 ? probe_stats.full_probe_us / 1000.0 / probe_stats.misses : 0.0;
+
+    HlmCodecCacheStats codec_cache_stats = HlmCodecCache::getInstance().getStats();
+    jsonResp["data"]["codec_cache"]["scaler_hits"] = codec_cache_stats.scaler_hits;
+    jsonResp["data"]["codec_cache"]["scaler_misses"] = codec_cache_stats.scaler_misses;
+    jsonResp["data"]["codec_cache"]["encoder_hits"] = codec_cache_stats.encoder_hits;
+    jsonResp["data"]["codec_cache"]["encoder_misses"] = codec_cache_stats.encoder_misses;
+    jsonResp["data"]["codec_cache"]["idle_scalers"] = codec_cache_stats.idle_scalers;
+    jsonResp["data"]["codec_cache"]["idle_encoders"] = codec_cache_stats.idle_encoders;
+    jsonResp["data"]["codec_cache"]["buffer_pools"] = codec_cache_stats.buffer_pools;
+
+    HlmScreenshotCacheStats cache_stats = HlmScreenshotCache::getInstance().getStats();
+    jsonResp["data"]["cache"]["memory_hits"] = cache_stats.memory_hits;
+    jsonResp["data"]["cache"]["disk_hits"] = cache_stats.disk_hits;
+    jsonResp["data"]["cache"]["misses"] = cache_stats.misses;
+    jsonResp["data"]["cache"]["insertions"] = cache_stats.insertions;
+    jsonResp["data"]["cache"]["evictions"] = cache_stats.evictions;
+    jsonResp["data"]["cache"]["memory_entries"] = cache_stats.memory_entries;
+    jsonResp["data"]["cache"]["memory_bytes"] = cache_stats.memory_bytes;
+    jsonResp["data"]["cache"]["disk_entries"] = cache_stats.disk_entries;
+    jsonResp["data"]["cache"]["disk_bytes"] = cache_stats.disk_bytes;
+    return response(jsonResp);
+}
+
+HlmMediaProfile HlmHttpServer::parseMediaProfile(const json::rvalue& body) {
+    // 可选的媒体信息，用于更准确地估算任务开销
+    HlmMediaProfile profile;
+    if (body.has("width") && body.has("height")) {
+        profile.width = body["width"].i();
+        profile.height = body["height"].i();
+    }
+    profile.codec = getOrDefault(body, "codec", profile.codec);
+    return profile;
+}
+
+HlmDecoderThreading HlmHttpServer::parseDecoderThreading(const json::rvalue& body) {
+    // 可选的解码多线程设置，覆盖配置中的 decoder 项
+    HlmDecoderThreading threading;
+    threading.thread_type = getOrDefault(body, "decoder_thread_type", "");
+    if (!threading.thread_type.empty() && !HlmDecoderThreadingPolicy::isValidThreadType(threading.thread_type)) {
+        throw invalid_argument("decoder_thread_type must be auto, frame or slice.");
+    }
+    if (body.has("decoder_threads")) {
+        threading.threads = body["decoder_threads"].i();
+        if (threading.threads < 0 || threading.threads > HlmDecoderThreadingPolicy::MAX_THREADS) {
+            throw invalid_argument("decoder_threads must be between 0 and " + to_string(HlmDecoderThreadingPolicy::MAX_THREADS) + ".");
+        }
+    }
+    return threading;
+}
+
 response HlmHttpServer::logWrapper(const request& req, function<response(const request&)> handler) {
     hlm_info("Received request url:{}, Body:{}", req.url, req.body);
     response res = handler(req);
-    hlm_info("Response url:{}, Body:{}", req.url, res.body);
+    // 同步截图的响应体是图片，只记录大小
+    if (res.get_header_value("Content-Type").find("image/") == 0) {
+        hlm_info("Response url:{}, code:{}, size:{}", req.url, res.code, res.body.size());
+    } else {
+        hlm_info("Response url:{}, Body:{}", req.url, res.body);
+    }
     return res;
 }
 
@@ -341,6 +591,16 @@ response HlmHttpServer::createJsonResponse(int code, const string& message) {
     return response(jsonResp);
 }
 
+response HlmHttpServer::createJsonResponse(int code, const string& message, const vector<string>& files) {
+    json::wvalue jsonResp;
+    jsonResp["code"] = code;
+    jsonResp["message"] = message;
+    if (!files.empty()) {
+        jsonResp["data"]["files"] = files;
+    }
+    return response(jsonResp);
+}
+
 bool HlmHttpServer::validateJson(const json::rvalue& body, const vector<string>& required_fields, map<string, string>& error_map) {
     for (const auto& field : required_fields) {
         if (!body.has(field)) {
@@ -1,10 +1,14 @@
 #ifndef HLM_HTTP_SERVER_H
 #define HLM_HTTP_SERVER_H
 
+#include "core/hlm_codec_cache.h"
 #include "core/hlm_executor.h"
+#include "core/hlm_input_pool.h"
 #include "core/hlm_mix_strategy.h"
+#include "core/hlm_probe_cache.h"
 #include "core/hlm_recording_strategy.h"
 #include "core/hlm_recording_task.h"
+#include "core/hlm_screenshot_cache.h"
 #include "core/hlm_screenshot_strategy.h"
 #include "core/hlm_screenshot_task.h"
 #include "core/hlm_task.h"
@@ -28,7 +32,7 @@ struct ValidationResult {
 
 class HlmHttpServer {
    public:
-    HlmHttpServer(int max_tasks);
+    HlmHttpServer(const TaskConfig& task_config);
     void start(int port);
     void setLogLevel(LogLevel level);
 
@@ -38,6 +42,9 @@ class HlmHttpServer {
     response manageScreenshotReq(const request& req);
     response startScreenshot(const json::rvalue& body);
     response stopScreenshot(const json::rvalue& body);
+    response captureInlineScreenshot(shared_ptr<HlmScreenshotTask> task);
+    bool serveCachedScreenshot(shared_ptr<HlmScreenshotTask> task, response& resp);
+    response getArchivedScreenshot(const request& req);
 
     response manageRecordingReq(const request& req);
     response startRecording(const json::rvalue& body);
@@ -50,10 +57,17 @@ class HlmHttpServer {
     HlmMixTaskParams parseMixParams(const json::rvalue& body);
     vector<HlmStreamInfo> parseStreams(const json::rvalue& streams_json);
 
+    response manageIngestReq(const request& req);
+
+    response getTaskStatus();
+    HlmMediaProfile parseMediaProfile(const json::rvalue& body);
+    HlmDecoderThreading parseDecoderThreading(const json::rvalue& body);
+
     // 装饰器模式：包装处理函数，添加日志功能
     response logWrapper(const request& req, function<response(const request&)> handler);
 
     response createJsonResponse(int code, const string& message);
+    response createJsonResponse(int code, const string& message, const vector<string>& files);
     bool validateJson(const json::rvalue& body, const vector<string>& required_fields, map<string, string>& error_map);
     string getOrDefault(const json::rvalue& body, const string& field, const string& default_value);
 
@@ -0,0 +1,204 @@
+#include "hlm_codec_cache.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+
+HlmCodecCache& HlmCodecCache::getInstance() {
+    static HlmCodecCache instance;
+    return instance;
+}
+
+HlmCodecCache::HlmCodecCache()
+    : enabled_(CONF.isCodecCacheEnabled()),
+      max_idle_per_key_(max(0, CONF.getCodecCacheMaxIdlePerKey())) {}
+
+HlmCodecCache::~HlmCodecCache() {
+    for (auto& idle : idle_scalers_) {
+        for (SwsContext* sws_ctx : idle.second) {
+            sws_freeContext(sws_ctx);
+        }
+    }
+    for (auto& idle : idle_encoders_) {
+        for (AVCodecContext* codec_context : idle.second) {
+            avcodec_free_context(&codec_context);
+        }
+    }
+    // 仍被帧引用的缓冲在释放后由 FFmpeg 回收缓冲池
+    for (auto& pool : buffer_pools_) {
+        av_buffer_pool_uninit(&pool.second);
+    }
+}
+
+string HlmCodecCache::scalerKey(int src_width, int src_height, AVPixelFormat src_pix_fmt,
+                                int dst_width, int dst_height, AVPixelFormat dst_pix_fmt, int flags) {
+    return to_string(src_width) + "x" + to_string(src_height) + "|" + to_string(src_pix_fmt) + "|" +
+           to_string(dst_width) + "x" + to_string(dst_height) + "|" + to_string(dst_pix_fmt) + "|" + to_string(flags);
+}
+
+string HlmCodecCache::imageEncoderKey(const AVCodecContext* codec_context) {
+    return string(codec_context->codec->name) + "|" + to_string(codec_context->width) + "x" + to_string(codec_context->height) + "|" +
+           to_string(codec_context->pix_fmt) + "|" + to_string(codec_context->flags) + "|" + to_string(codec_context->global_quality) + "|" +
+           to_string(codec_context->color_range) + "|" + to_string(codec_context->strict_std_compliance);
+}
+
+SwsContext* HlmCodecCache::checkoutScaler(const string& key) {
+    lock_guard<mutex> lock(mutex_);
+    auto it = idle_scalers_.find(key);
+    if (it == idle_scalers_.end() || it->second.empty()) {
+        stats_.scaler_misses++;
+        return nullptr;
+    }
+    SwsContext* sws_ctx = it->second.back();
+    it->second.pop_back();
+    stats_.idle_scalers--;
+    stats_.scaler_hits++;
+    return sws_ctx;
+}
+
+void HlmCodecCache::checkinScaler(const string& key, SwsContext* sws_ctx) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto& idle = idle_scalers_[key];
+        if (enabled_ && idle.size() < max_idle_per_key_) {
+            idle.push_back(sws_ctx);
+            stats_.idle_scalers++;
+            return;
+        }
+    }
+    sws_freeContext(sws_ctx);
+}
+
+AVCodecContext* HlmCodecCache::checkoutImageEncoder(const string& key) {
+    lock_guard<mutex> lock(mutex_);
+    auto it = idle_encoders_.find(key);
+    if (it == idle_encoders_.end() || it->second.empty()) {
+        stats_.encoder_misses++;
+        return nullptr;
+    }
+    AVCodecContext* codec_context = it->second.back();
+    it->second.pop_back();
+    stats_.idle_encoders--;
+    stats_.encoder_hits++;
+    return codec_context;
+}
+
+void HlmCodecCache::checkinImageEncoder(const string& key, AVCodecContext* codec_context) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto& idle = idle_encoders_[key];
+        if (enabled_ && idle.size() < max_idle_per_key_) {
+            idle.push_back(codec_context);
+            stats_.idle_encoders++;
+            return;
+        }
+    }
+    avcodec_free_context(&codec_context);
+}
+
+bool HlmCodecCache::getFrameBuffer(AVFrame* frame, int width, int height, AVPixelFormat pix_fmt) {
+    int size = av_image_get_buffer_size(pix_fmt, width, height, FRAME_ALIGN);
+    if (size < 0) {
+        return false;
+    }
+
+    AVBufferPool* pool = nullptr;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = buffer_pools_.find(size);
+        if (it == buffer_pools_.end()) {
+            pool = av_buffer_pool_init(size, nullptr);
+            if (!pool) {
+                return false;
+            }
+            buffer_pools_[size] = pool;
+            stats_.buffer_pools = buffer_pools_.size();
+        } else {
+            pool = it->second;
+        }
+    }
+
+    // 缓冲池自身是线程安全的
+    frame->buf[0] = av_buffer_pool_get(pool);
+    if (!frame->buf[0]) {
+        return false;
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->format = pix_fmt;
+    if (av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, pix_fmt, width, height, FRAME_ALIGN) < 0) {
+        av_frame_unref(frame);
+        return false;
+    }
+    return true;
+}
+
+HlmCodecCacheStats HlmCodecCache::getStats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+HlmScaler::~HlmScaler() {
+    if (sws_ctx_) {
+        HlmCodecCache::getInstance().checkinScaler(key_, sws_ctx_);
+        sws_ctx_ = nullptr;
+    }
+    if (scaled_frame_) {
+        av_frame_free(&scaled_frame_);
+    }
+}
+
+bool HlmScaler::init(int src_width, int src_height, AVPixelFormat src_pix_fmt,
+                     int dst_width, int dst_height, AVPixelFormat dst_pix_fmt) {
+    key_ = HlmCodecCache::scalerKey(src_width, src_height, src_pix_fmt, dst_width, dst_height, dst_pix_fmt, SWS_BILINEAR);
+    sws_ctx_ = HlmCodecCache::getInstance().checkoutScaler(key_);
+    if (!sws_ctx_) {
+        hlm_info("Initializing scaler from {}x{} ({}) to {}x{} ({}).",
+                 src_width, src_height, av_get_pix_fmt_name(src_pix_fmt), dst_width, dst_height, av_get_pix_fmt_name(dst_pix_fmt));
+        sws_ctx_ = sws_getContext(src_width, src_height, src_pix_fmt,
+                                  dst_width, dst_height, dst_pix_fmt,
+                                  SWS_BILINEAR, nullptr, nullptr, nullptr);
+    }
+    if (!sws_ctx_) {
+        hlm_error("Failed to initialize the scaling context. ");
+        return false;
+    }
+
+    scaled_frame_ = av_frame_alloc();
+    if (!scaled_frame_) {
+        hlm_error("Failed to allocate scaled frame.");
+        return false;
+    }
+
+    dst_width_ = dst_width;
+    dst_height_ = dst_height;
+    dst_pix_fmt_ = dst_pix_fmt;
+    return true;
+}
+
+AVFrame* HlmScaler::scale(AVFrame* frame) {
+    if (!sws_ctx_) {
+        hlm_error("Scaler context not initialized.");
+        return nullptr;
+    }
+
+    // 上一帧的缓冲可能仍被编码器引用，每帧从缓冲池取新的缓冲，不覆盖旧数据
+    av_frame_unref(scaled_frame_);
+    if (!HlmCodecCache::getInstance().getFrameBuffer(scaled_frame_, dst_width_, dst_height_, dst_pix_fmt_)) {
+        hlm_error("Failed to allocate buffer for scaled frame.");
+        return nullptr;
+    }
+
+    sws_scale(sws_ctx_, frame->data, frame->linesize, 0, frame->height,
+              scaled_frame_->data, scaled_frame_->linesize);
+
+    scaled_frame_->pts = frame->pts;
+    scaled_frame_->pkt_duration = frame->pkt_duration;
+    return scaled_frame_;
+}
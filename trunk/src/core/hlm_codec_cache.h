@@ -0,0 +1,92 @@
+#ifndef HLM_CODEC_CACHE_H
+#define HLM_CODEC_CACHE_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct HlmCodecCacheStats {
+    uint64_t scaler_hits = 0;     // 复用空闲缩放上下文的次数
+    uint64_t scaler_misses = 0;   // 新建缩放上下文的次数
+    uint64_t encoder_hits = 0;    // 复用空闲图片编码器的次数
+    uint64_t encoder_misses = 0;  // 新建图片编码器的次数
+    size_t idle_scalers = 0;
+    size_t idle_encoders = 0;
+    size_t buffer_pools = 0;  // 缩放输出帧缓冲池数，每种缓冲大小一个
+};
+
+// 进程级的缩放上下文和图片编码器缓存：相同参数的任务共用滤波系数表和编码器初始化结果，
+// 任务开始时取出、结束后归还；缩放输出帧的缓冲来自按大小划分的缓冲池
+class HlmCodecCache {
+   public:
+    static HlmCodecCache& getInstance();
+    ~HlmCodecCache();
+
+    static string scalerKey(int src_width, int src_height, AVPixelFormat src_pix_fmt,
+                            int dst_width, int dst_height, AVPixelFormat dst_pix_fmt, int flags);
+    // 按编码器名称和已设置的编码参数生成 key，需在 avcodec_open2 前调用
+    static string imageEncoderKey(const AVCodecContext* codec_context);
+
+    // 没有空闲的上下文时返回空，由调用方新建
+    SwsContext* checkoutScaler(const string& key);
+    void checkinScaler(const string& key, SwsContext* sws_ctx);
+    AVCodecContext* checkoutImageEncoder(const string& key);
+    void checkinImageEncoder(const string& key, AVCodecContext* codec_context);
+
+    // 为帧分配缓冲池中的缓冲，帧释放后缓冲回到池中
+    bool getFrameBuffer(AVFrame* frame, int width, int height, AVPixelFormat pix_fmt);
+
+    HlmCodecCacheStats getStats() const;
+
+   private:
+    HlmCodecCache();
+    HlmCodecCache(const HlmCodecCache&) = delete;
+    HlmCodecCache& operator=(const HlmCodecCache&) = delete;
+
+    bool enabled_;
+    size_t max_idle_per_key_;
+
+    mutable mutex mutex_;
+    unordered_map<string, vector<SwsContext*>> idle_scalers_;
+    unordered_map<string, vector<AVCodecContext*>> idle_encoders_;
+    unordered_map<int, AVBufferPool*> buffer_pools_;  // 按缓冲大小索引
+    HlmCodecCacheStats stats_;
+
+    static const int FRAME_ALIGN = 32;
+};
+
+// 从缓存取出的缩放上下文，析构时归还
+class HlmScaler {
+   public:
+    HlmScaler() = default;
+    ~HlmScaler();
+
+    bool init(int src_width, int src_height, AVPixelFormat src_pix_fmt,
+              int dst_width, int dst_height, AVPixelFormat dst_pix_fmt);
+    // 返回的帧在下一次缩放前有效，需要长期持有时调用方自行 av_frame_clone
+    AVFrame* scale(AVFrame* frame);
+
+   private:
+    HlmScaler(const HlmScaler&) = delete;
+    HlmScaler& operator=(const HlmScaler&) = delete;
+
+    string key_;
+    SwsContext* sws_ctx_ = nullptr;
+    AVFrame* scaled_frame_ = nullptr;
+    int dst_width_ = 0;
+    int dst_height_ = 0;
+    AVPixelFormat dst_pix_fmt_ = AV_PIX_FMT_NONE;
+};
+
+#endif  // HLM_CODEC_CACHE_H
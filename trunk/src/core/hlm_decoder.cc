@@ -1,7 +1,60 @@
 #include "hlm_decoder.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include "utils/hlm_config.h"
+
+atomic<int> HlmDecoderThreadingPolicy::active_decoders_{0};
+
+void HlmDecoderThreadingPolicy::apply(AVCodecContext* codec_context, const HlmDecoderThreading& threading, bool low_latency) {
+    codec_context->thread_type = resolveThreadType(threading, low_latency);
+    codec_context->thread_count = resolveThreadCount(threading);
+    hlm_debug("Decoder threading: {} x {}, active decoders: {}",
+              codec_context->thread_type == FF_THREAD_SLICE ? HlmDecoderThreadType::Slice : HlmDecoderThreadType::Frame,
+              codec_context->thread_count, activeDecoders());
+}
+
+int HlmDecoderThreadingPolicy::resolveThreadType(const HlmDecoderThreading& threading, bool low_latency) {
+    const string& thread_type = threading.thread_type.empty() ? CONF.getDecoderThreadType() : threading.thread_type;
+    if (thread_type == HlmDecoderThreadType::Frame) {
+        return FF_THREAD_FRAME;
+    }
+    if (thread_type == HlmDecoderThreadType::Slice) {
+        return FF_THREAD_SLICE;
+    }
+    // 帧级多线程在输出第一帧前要先送入与线程数相同的包，低延迟任务改用片级多线程
+    return low_latency ? FF_THREAD_SLICE : FF_THREAD_FRAME;
+}
+
+int HlmDecoderThreadingPolicy::resolveThreadCount(const HlmDecoderThreading& threading) {
+    int threads = threading.threads >= 0 ? threading.threads : CONF.getDecoderThreads();
+    if (threads > 0) {
+        return threads;
+    }
+
+    // CPU 预算平分给正在解码的任务，至少一个线程
+    int decoders = max(1, activeDecoders());
+    int max_threads = max(1, CONF.getDecoderMaxThreads());
+    return clamp(static_cast<int>(CONF.getCpuBudget() / decoders), 1, max_threads);
+}
+
+bool HlmDecoderThreadingPolicy::isValidThreadType(const string& thread_type) {
+    return thread_type == HlmDecoderThreadType::Auto || thread_type == HlmDecoderThreadType::Frame || thread_type == HlmDecoderThreadType::Slice;
+}
+
+void HlmDecoderThreadingPolicy::decodingStarted() {
+    active_decoders_++;
+}
+
+void HlmDecoderThreadingPolicy::decodingFinished() {
+    active_decoders_--;
+}
+
+int HlmDecoderThreadingPolicy::activeDecoders() {
+    return active_decoders_;
+}
+
 HlmDecoder::HlmDecoder(int stream_index)
     : codec_context_(nullptr), stream_index_(stream_index) {
 }
@@ -98,8 +151,12 @@ bool HlmDecoder::initDecoder(AVFormatContext* format_context) {
         return false;
     }
 
-    codec_context_->thread_count = 16;
-    codec_context_->thread_type = FF_THREAD_FRAME;
+    HlmDecoderThreadingPolicy::apply(codec_context_, threading_, low_latency_);
+    if (keyframes_only_) {
+        // 只解码关键帧，帧级多线程会缓存多个关键帧后才输出，改用片级多线程
+        codec_context_->skip_frame = AVDISCARD_NONKEY;
+        codec_context_->thread_type = FF_THREAD_SLICE;
+    }
 
     if (avcodec_open2(codec_context_, codec, nullptr) < 0) {
         hlm_error("Failed to open decoder for stream index: {}", stream_index_);
@@ -122,6 +179,19 @@ bool HlmDecoder::decodePacket(AVPacket* pkt, AVFrame* frame) {
     return false;
 }
 
+void HlmDecoder::decodePacket(AVPacket* pkt, function<void(AVFrame*, int)> processFramesCallback) {
+    if (avcodec_send_packet(codec_context_, pkt) < 0) {
+        return;
+    }
+
+    AVFrame* frame = av_frame_alloc();
+    while (avcodec_receive_frame(codec_context_, frame) == 0) {
+        processFramesCallback(frame, stream_index_);
+        av_frame_unref(frame);
+    }
+    av_frame_free(&frame);
+}
+
 AVCodecContext* HlmDecoder::getCodecContext() const {
     return codec_context_;
 }
@@ -130,6 +200,14 @@ AVFormatContext* HlmDecoder::getFormatContext() const {
     return format_context_;
 }
 
+void HlmDecoder::setKeyframesOnly(bool keyframes_only) {
+    keyframes_only_ = keyframes_only;
+}
+
+void HlmDecoder::setThreading(const HlmDecoderThreading& threading, bool low_latency) {
+    threading_ = threading;
+    low_latency_ = low_latency;
+}
 
 void HlmDecoder::flushDecoder(function<void(AVFrame*, int)> processFramesCallback) {
     AVFrame* frame = av_frame_alloc();
@@ -158,43 +236,18 @@ void HlmDecoder::flushDecoder(function<void(AVFrame*, int)> processFramesCallbac
 
 bool HlmDecoder::initScaler(int src_width, int src_height, AVPixelFormat src_pix_fmt,
                             int dst_width, int dst_height, AVPixelFormat dst_pix_fmt) {
-    hlm_info("Initializing scaler from {}x{} ({}) to {}x{} ({}).",
-             src_width, src_height, av_get_pix_fmt_name(src_pix_fmt), dst_width, dst_height, av_get_pix_fmt_name(dst_pix_fmt));
-    sws_ctx_ = sws_getContext(src_width, src_height, src_pix_fmt,
-                              dst_width, dst_height, dst_pix_fmt,
-                              SWS_BILINEAR, nullptr, nullptr, nullptr);
-    if (!sws_ctx_) {
-        hlm_error("Failed to initialize the scaling context. ");
-        return false;
-    }
-
-    scaled_frame_ = av_frame_alloc();
-    if (!scaled_frame_) {
-        hlm_error("Failed to allocate scaled frame.");
-        return false;
-    }
-
-    scaled_frame_->width = dst_width;
-    scaled_frame_->height = dst_height;
-    scaled_frame_->format = dst_pix_fmt;
-    if (av_frame_get_buffer(scaled_frame_, 32) < 0) {
-        hlm_error("Failed to allocate buffer for scaled frame.");
+    scaler_ = make_unique<HlmScaler>();
+    if (!scaler_->init(src_width, src_height, src_pix_fmt, dst_width, dst_height, dst_pix_fmt)) {
+        scaler_.reset();
         return false;
     }
-
     return true;
 }
 
 AVFrame* HlmDecoder::scaleFrame(AVFrame* frame) {
-    if (!sws_ctx_) {
+    if (!scaler_) {
         hlm_error("Scaler context not initialized.");
         return nullptr;
     }
-
-    sws_scale(sws_ctx_, frame->data, frame->linesize, 0, frame->height,
-              scaled_frame_->data, scaled_frame_->linesize);
-
-    scaled_frame_->pts = frame->pts;
-    scaled_frame_->pkt_duration = frame->pkt_duration;
-    return scaled_frame_;
+    return scaler_->scale(frame);
 }
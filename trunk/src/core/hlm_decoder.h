@@ -11,13 +11,49 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <string>
 
+#include "hlm_codec_cache.h"
 #include "utils/hlm_logger.h"
 
 using namespace std;
 
+// 解码多线程方式
+namespace HlmDecoderThreadType {
+const string Auto = "auto";    // 低延迟任务用 slice，其他任务用 frame
+const string Frame = "frame";  // 帧级多线程，吞吐高，但会缓存与线程数相同的帧后才输出
+const string Slice = "slice";  // 片级多线程，不增加延迟，并行度取决于码流的分片数
+}  // namespace HlmDecoderThreadType
+
+// 任务的解码多线程设置，未指定的字段使用配置
+struct HlmDecoderThreading {
+    string thread_type;  // 为空时使用配置
+    int threads = -1;    // 0 表示自动计算，-1 时使用配置
+};
+
+// 解码线程策略：线程数按 CPU 预算和正在解码的任务数自动分配，避免多任务时线程数超过核数
+class HlmDecoderThreadingPolicy {
+   public:
+    // 设置解码器的线程方式和线程数，需在 avcodec_open2 前调用
+    static void apply(AVCodecContext* codec_context, const HlmDecoderThreading& threading, bool low_latency);
+    static int resolveThreadType(const HlmDecoderThreading& threading, bool low_latency);
+    static int resolveThreadCount(const HlmDecoderThreading& threading);
+    static bool isValidThreadType(const string& thread_type);
+
+    // 正在解码的任务数，拉流会话的共享解码器计为一个
+    static void decodingStarted();
+    static void decodingFinished();
+    static int activeDecoders();
+
+    static const int MAX_THREADS = 64;  // 请求中可指定的最大线程数
+
+   private:
+    static atomic<int> active_decoders_;
+};
+
 class HlmDecoder {
    public:
     HlmDecoder(int stream_index);
@@ -28,8 +64,11 @@ class HlmDecoder {
     bool initDecoder();
     bool initDecoder(AVFormatContext* format_context);
     bool decodePacket(AVPacket* pkt, AVFrame* frame);
+    void decodePacket(AVPacket* pkt, function<void(AVFrame*, int)> processFramesCallback);
     AVCodecContext* getCodecContext() const;
     AVFormatContext* getFormatContext() const;
+    void setKeyframesOnly(bool keyframes_only);
+    void setThreading(const HlmDecoderThreading& threading, bool low_latency);
     void flushDecoder(function<void(AVFrame*, int)> processFramesCallback);
 
     bool initScaler(int src_width, int src_height, AVPixelFormat src_pix_fmt,
@@ -41,9 +80,11 @@ class HlmDecoder {
     AVFormatContext* format_context_;
     AVMediaType media_type_;
     int stream_index_ = -1;
+    bool keyframes_only_ = false;
+    HlmDecoderThreading threading_;
+    bool low_latency_ = false;
 
-    struct SwsContext* sws_ctx_;
-    AVFrame* scaled_frame_;
+    unique_ptr<HlmScaler> scaler_;
 };
 
 #endif  // HLM_DECODER_H
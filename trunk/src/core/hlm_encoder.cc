@@ -6,22 +6,17 @@
 using namespace spdlog;
 
 HlmEncoder::HlmEncoder()
-    : ecodec_context_(nullptr), stream_(nullptr), sws_ctx_(nullptr), scaled_frame_(nullptr) {
+    : ecodec_context_(nullptr), stream_(nullptr) {
 }
 
 HlmEncoder::~HlmEncoder() {
-    if (ecodec_context_) {
-        avcodec_free_context(&ecodec_context_);
-    }
-
-    if (sws_ctx_) {
-        sws_freeContext(sws_ctx_);
-        sws_ctx_ = nullptr;
+    if (ecodec_context_ && !image_encoder_key_.empty()) {
+        HlmCodecCache::getInstance().checkinImageEncoder(image_encoder_key_, ecodec_context_);
+        ecodec_context_ = nullptr;
     }
 
-    if (scaled_frame_) {
-        av_frame_free(&scaled_frame_);
-        scaled_frame_ = nullptr;
+    if (ecodec_context_) {
+        avcodec_free_context(&ecodec_context_);
     }
 }
 
@@ -43,9 +38,7 @@ bool HlmEncoder::initEncoderForImage(AVCodecContext* decoder_context, const stri
     ecodec_context_->width = decoder_context->width;
     ecodec_context_->height = decoder_context->height;
 
-    if (avcodec_open2(ecodec_context_, codec, nullptr) < 0) {
-        hlm_error("Failed to open encoder.");
-        avcodec_free_context(&ecodec_context_);
+    if (!openImageEncoder(codec)) {
         return false;
     }
 
@@ -53,6 +46,93 @@ bool HlmEncoder::initEncoderForImage(AVCodecContext* decoder_context, const stri
     return true;
 }
 
+const AVCodec* HlmEncoder::findImageEncoder(const string& image_format) {
+    if (image_format == HlmImageFormat::Png) {
+        return avcodec_find_encoder(AV_CODEC_ID_PNG);
+    } else if (image_format == HlmImageFormat::Jpeg) {
+        return avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    } else if (image_format == HlmImageFormat::Webp) {
+        return avcodec_find_encoder_by_name("libwebp");
+    }
+    return nullptr;
+}
+
+bool HlmEncoder::initImageEncoder(AVCodecContext* decoder_context, const HlmImageOptions& options, int width, int height) {
+    const AVCodec* codec = findImageEncoder(options.format);
+    if (!codec) {
+        hlm_error("Failed to find image encoder. image_format:{}", options.format);
+        return false;
+    }
+
+    ecodec_context_ = avcodec_alloc_context3(codec);
+    if (!ecodec_context_) {
+        hlm_error("Failed to allocate encoder context.");
+        return false;
+    }
+
+    // 编码器支持解码输出的像素格式时直接编码，jpeg/webp 可以直接使用解码出的 YUV 平面，不需要转换成 RGB
+    AVPixelFormat pix_fmt = AV_PIX_FMT_NONE;
+    for (const AVPixelFormat* fmt = codec->pix_fmts; fmt && *fmt != AV_PIX_FMT_NONE; ++fmt) {
+        if (*fmt == decoder_context->pix_fmt) {
+            pix_fmt = *fmt;
+            break;
+        }
+    }
+    if (pix_fmt == AV_PIX_FMT_NONE) {
+        if (options.format == HlmImageFormat::Jpeg) {
+            pix_fmt = AV_PIX_FMT_YUVJ420P;
+        } else if (options.format == HlmImageFormat::Webp) {
+            pix_fmt = AV_PIX_FMT_YUV420P;
+        } else {
+            pix_fmt = AV_PIX_FMT_RGB24;
+        }
+    }
+
+    ecodec_context_->pix_fmt = pix_fmt;
+    ecodec_context_->time_base = (AVRational){1, 1};
+    ecodec_context_->width = width > 0 ? width : decoder_context->width;
+    ecodec_context_->height = height > 0 ? height : decoder_context->height;
+
+    int quality = av_clip(options.quality, 1, 100);
+    if (options.format == HlmImageFormat::Jpeg) {
+        // 质量 1-100 映射到 mjpeg 的 qscale 31-2，使用固定量化
+        ecodec_context_->flags |= AV_CODEC_FLAG_QSCALE;
+        ecodec_context_->global_quality = FF_QP2LAMBDA * (31 - (quality - 1) * 29 / 99);
+        // 允许 mjpeg 直接编码 MPEG 范围的 YUV420P
+        ecodec_context_->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+        ecodec_context_->color_range = decoder_context->color_range;
+    } else if (options.format == HlmImageFormat::Webp) {
+        ecodec_context_->global_quality = FF_QP2LAMBDA * quality;
+    }
+
+    if (!openImageEncoder(codec)) {
+        return false;
+    }
+
+    hlm_info("{} image encoder initialized successfully. size: {}x{}, pix_fmt: {}, quality: {}",
+             codec->name, ecodec_context_->width, ecodec_context_->height, av_get_pix_fmt_name(pix_fmt), quality);
+    return true;
+}
+
+bool HlmEncoder::openImageEncoder(const AVCodec* codec) {
+    // 参数相同的图片编码器从缓存取出，省去 avcodec_open2；图片编码器每帧独立编码，不保留帧间状态
+    image_encoder_key_ = HlmCodecCache::imageEncoderKey(ecodec_context_);
+    AVCodecContext* cached = HlmCodecCache::getInstance().checkoutImageEncoder(image_encoder_key_);
+    if (cached) {
+        avcodec_free_context(&ecodec_context_);
+        ecodec_context_ = cached;
+        return true;
+    }
+
+    if (avcodec_open2(ecodec_context_, codec, nullptr) < 0) {
+        hlm_error("Failed to open {} encoder.", codec->name);
+        avcodec_free_context(&ecodec_context_);
+        image_encoder_key_.clear();
+        return false;
+    }
+    return true;
+}
+
 bool HlmEncoder::initVideoEncoder(const EncoderParams& params, AVFormatContext* output_format_context) {
     AVStream* video_stream = avformat_new_stream(output_format_context, nullptr);
     if (!video_stream) {
@@ -148,6 +228,11 @@ bool HlmEncoder::initAudioEncoder(const EncoderParams& params, AVFormatContext*
 }
 
 bool HlmEncoder::encodeFrame(AVFrame* frame, AVPacket* pkt) {
+    // 固定量化的编码器从每一帧读取量化值
+    if (frame && (ecodec_context_->flags & AV_CODEC_FLAG_QSCALE)) {
+        frame->quality = ecodec_context_->global_quality;
+    }
+
     if (avcodec_send_frame(ecodec_context_, frame) < 0) {
         return false;
     }
@@ -169,6 +254,11 @@ bool HlmEncoder::encodeFrame(AVFrame* frame, AVPacket* pkt) {
 }
 
 void HlmEncoder::flushEncoder(function<void(AVPacket*, int)> checkAndSavePacket) {
+    // 没有延迟的编码器每帧立即输出，无需刷新；不发送结束帧，图片编码器归还缓存后仍可继续编码
+    if (!(ecodec_context_->codec->capabilities & AV_CODEC_CAP_DELAY)) {
+        return;
+    }
+
     AVPacket* packet = av_packet_alloc();
     int ret;
 
@@ -202,43 +292,18 @@ AVCodecContext* HlmEncoder::getContext() const {
 
 bool HlmEncoder::initScaler(int src_width, int src_height, AVPixelFormat src_pix_fmt,
                             int dst_width, int dst_height, AVPixelFormat dst_pix_fmt) {
-    hlm_info("Initializing scaler from {}x{} ({}) to {}x{} ({}).",
-             src_width, src_height, av_get_pix_fmt_name(src_pix_fmt), dst_width, dst_height, av_get_pix_fmt_name(dst_pix_fmt));
-    sws_ctx_ = sws_getContext(src_width, src_height, src_pix_fmt,
-                              dst_width, dst_height, dst_pix_fmt,
-                              SWS_BILINEAR, nullptr, nullptr, nullptr);
-    if (!sws_ctx_) {
-        hlm_error("Failed to initialize the scaling context. ");
+    scaler_ = make_unique<HlmScaler>();
+    if (!scaler_->init(src_width, src_height, src_pix_fmt, dst_width, dst_height, dst_pix_fmt)) {
+        scaler_.reset();
         return false;
     }
-
-    scaled_frame_ = av_frame_alloc();
-    if (!scaled_frame_) {
-        hlm_error("Failed to allocate scaled frame.");
-        return false;
-    }
-
-    scaled_frame_->width = dst_width;
-    scaled_frame_->height = dst_height;
-    scaled_frame_->format = dst_pix_fmt;
-    if (av_frame_get_buffer(scaled_frame_, 32) < 0) {
-        hlm_error("Failed to allocate buffer for scaled frame.");
-        return false;
-    }
-
     return true;
 }
 
 AVFrame* HlmEncoder::scaleFrame(AVFrame* frame) {
-    if (!sws_ctx_) {
+    if (!scaler_) {
         hlm_error("Scaler context not initialized.");
         return nullptr;
     }
-
-    sws_scale(sws_ctx_, frame->data, frame->linesize, 0, frame->height,
-              scaled_frame_->data, scaled_frame_->linesize);
-
-    scaled_frame_->pts = frame->pts;
-    scaled_frame_->pkt_duration = frame->pkt_duration;
-    return scaled_frame_;
+    return scaler_->scale(frame);
 }
@@ -13,9 +13,25 @@ extern "C" {
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "hlm_codec_cache.h"
 
 using namespace std;
 
+namespace HlmImageFormat {
+const string Png = "png";
+const string Jpeg = "jpeg";
+const string Webp = "webp";
+}  // namespace HlmImageFormat
+
+// 截图输出参数
+struct HlmImageOptions {
+    string format = HlmImageFormat::Png;  // 图片格式
+    int quality = 85;                     // jpeg/webp 质量，取值 1-100
+    vector<int> widths;                   // 输出宽度列表，高度按原始宽高比计算，为空时输出原始分辨率
+};
+
 struct EncoderParams {
     int width = 0;                               // 视频宽度
     int height = 0;                              // 视频高度
@@ -37,6 +53,8 @@ class HlmEncoder {
     ~HlmEncoder();
 
     bool initEncoderForImage(AVCodecContext* decoder_context, const string& codec_name = "");
+    bool initImageEncoder(AVCodecContext* decoder_context, const HlmImageOptions& options, int width = 0, int height = 0);
+    static const AVCodec* findImageEncoder(const string& image_format);
     bool initVideoEncoder(const EncoderParams& params, AVFormatContext* output_format_context);
     bool initAudioEncoder(const EncoderParams& params, AVFormatContext* output_format_context);
     bool encodeFrame(AVFrame* frame, AVPacket* pkt);
@@ -47,13 +65,16 @@ class HlmEncoder {
     bool initScaler(int src_width, int src_height, AVPixelFormat src_pix_fmt,
                     int dst_width, int dst_height, AVPixelFormat dst_pix_fmt);
     AVFrame* scaleFrame(AVFrame* frame);
+    bool hasScaler() const { return scaler_ != nullptr; }
 
    private:
+    bool openImageEncoder(const AVCodec* codec);
+
     AVCodecContext* ecodec_context_;
     AVStream* stream_;
 
-    struct SwsContext* sws_ctx_;
-    AVFrame* scaled_frame_;
+    unique_ptr<HlmScaler> scaler_;
+    string image_encoder_key_;  // 非空时编码器来自或归还到进程级缓存
     int stream_index_ = -1;
 };
 
@@ -2,23 +2,40 @@
 
 #include <filesystem>
 
+#include "hlm_input_pool.h"
+#include "hlm_probe_cache.h"
+#include "utils/hlm_config.h"
 #include "utils/hlm_logger.h"
 #include "utils/hlm_time.h"
 
 HlmExecutor::HlmExecutor() {}
 
 HlmExecutor::HlmExecutor(const string& stream_url, const string& output_dir, const string& filename, const string& media_method)
-    : stream_url_(stream_url), output_dir_(output_dir), filename_(filename), media_method_(media_method) {     
+    : stream_url_(stream_url), output_dir_(output_dir), filename_(filename), media_method_(media_method) {
+    write_backlog_ = HlmFileWriter::getInstance().createBacklog(media_method_ + " " + stream_url_);
 }
 
 HlmExecutor::~HlmExecutor() {
+    if (decoding_started_) {
+        HlmDecoderThreadingPolicy::decodingFinished();
+    }
+
+    // 输入和解码器都已就绪时归还输入池，由下一个同文件任务复用
+    if (!input_pool_key_.empty() && input_format_context_ && video_decoder_ && owns_video_decoder_) {
+        HlmInputPool::getInstance().checkin(input_pool_key_, {input_format_context_, video_decoder_});
+        input_format_context_ = nullptr;
+        video_decoder_ = nullptr;
+    }
+
     if (video_encoder_) {
         delete video_encoder_;
         video_encoder_ = nullptr;
     }
 
     if (video_decoder_) {
-        delete video_decoder_;
+        if (owns_video_decoder_) {
+            delete video_decoder_;
+        }
         video_decoder_ = nullptr;
     }
 
@@ -32,10 +49,7 @@ HlmExecutor::~HlmExecutor() {
         audio_decoder_ = nullptr;
     }
 
-    if (input_format_context_) {
-        avformat_close_input(&input_format_context_);
-        input_format_context_ = nullptr;
-    }
+    closeInput();
 }
 
 void HlmExecutor::stop() {
@@ -64,6 +78,24 @@ bool HlmExecutor::ensureDirectoryExists(const string& dir_path) {
 bool HlmExecutor::openInputStream() {
     av_log_set_level(AV_LOG_ERROR);
 
+    if (useSharedIngest()) {
+        return openSharedIngest();
+    }
+
+    if (usesInputPool()) {
+        int thread_type = HlmDecoderThreadingPolicy::resolveThreadType(decoder_threading_, lowLatency());
+        input_pool_key_ = HlmInputPool::poolKey(stream_url_, keyframesOnly(), thread_type);
+        HlmPooledInput pooled;
+        if (!input_pool_key_.empty() && HlmInputPool::getInstance().checkout(input_pool_key_, pooled)) {
+            input_format_context_ = pooled.format_context;
+            video_decoder_ = pooled.video_decoder;
+            updateStartTime();
+            input_format_context_->interrupt_callback = {interruptCallback, this};
+            hlm_info("Reusing pooled input for: {}", stream_url_);
+            return true;
+        }
+    }
+
     input_format_context_ = avformat_alloc_context();
     if (!input_format_context_) {
         hlm_error("Failed to allocate AVFormatContext.");
@@ -81,7 +113,7 @@ bool HlmExecutor::openInputStream() {
     }
     updateStartTime();
 
-    if (avformat_find_stream_info(input_format_context_, nullptr) < 0) {
+    if (!HlmProbeCache::getInstance().probe(input_format_context_, stream_url_, probeSettings())) {
         hlm_error("Failed to retrieve stream info for: {}", stream_url_);
         return false;
     }
@@ -103,6 +135,11 @@ bool HlmExecutor::findStreams() {
     }
 
     if (input_video_stream_index_ != -1) {
+        if (keyframesOnly() && !ingest_session_) {
+            for (unsigned int i = 0; i < input_format_context_->nb_streams; i++) {
+                input_format_context_->streams[i]->discard = (static_cast<int>(i) == input_video_stream_index_) ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+            }
+        }
         return true;
     }
 
@@ -113,8 +150,32 @@ bool HlmExecutor::findStreams() {
 bool HlmExecutor::initDecoder() {
     bool decoder_initialized = false;
 
+    if (ingest_subscriber_ && ingest_subscriber_->needVideoFrames()) {
+        video_decoder_ = ingest_session_->acquireVideoDecoder();
+        owns_video_decoder_ = false;
+        if (!video_decoder_) {
+            hlm_error("Failed to acquire shared video decoder for stream: {}", stream_url_);
+            return false;
+        }
+        hlm_info("Using shared ingest video decoder for stream: {}", stream_url_);
+        return true;
+    }
+
+    // 从输入池取出的输入已带有打开的视频解码器
+    if (video_decoder_) {
+        HlmDecoderThreadingPolicy::decodingStarted();
+        decoding_started_ = true;
+        hlm_info("Using pooled video decoder for stream: {}", stream_url_);
+        return true;
+    }
+
     if (input_video_stream_index_ != -1) {
+        // 先计入本任务再计算线程数，新任务和已有任务平分CPU预算
+        HlmDecoderThreadingPolicy::decodingStarted();
+        decoding_started_ = true;
         video_decoder_ = new HlmDecoder(input_video_stream_index_);
+        video_decoder_->setKeyframesOnly(keyframesOnly());
+        video_decoder_->setThreading(decoder_threading_, lowLatency());
         if (!video_decoder_->initDecoder(input_format_context_)) {
             hlm_error("Failed to initialize video decoder for stream: {}, stream index: {}", stream_url_, input_video_stream_index_);
             return false;
@@ -123,7 +184,7 @@ bool HlmExecutor::initDecoder() {
         hlm_info("Video decoder initialized successfully for stream index: {}", input_video_stream_index_);
     }
 
-    if (input_audio_stream_index_ != -1) {
+    if (input_audio_stream_index_ != -1 && needsAudioDecoder()) {
         audio_decoder_ = new HlmDecoder(input_audio_stream_index_);
         if (!audio_decoder_->initDecoder(input_format_context_)) {
             hlm_error("Failed to initialize audio decoder for stream: {}, stream index: {}", stream_url_, input_audio_stream_index_);
@@ -141,6 +202,10 @@ bool HlmExecutor::initDecoder() {
     return true;
 }
 
+void HlmExecutor::setDecoderThreading(const HlmDecoderThreading& threading) {
+    decoder_threading_ = threading;
+}
+
 bool HlmExecutor::initScaler() {
     if (!video_encoder_) {
         video_encoder_ = new HlmEncoder();
@@ -153,6 +218,115 @@ bool HlmExecutor::initScaler() {
     return true;
 }
 
+bool HlmExecutor::useSharedIngest() const {
+    if (HlmIngestManager::getInstance().isPinned(stream_url_)) {
+        return true;
+    }
+    return CONF.isSharedIngestEnabled() && stream_url_.find("rtmp://") == 0;
+}
+
+bool HlmExecutor::openSharedIngest() {
+    // 常驻流上回放缓存的 GOP 并自行解码，第一帧不必等待下一个关键帧
+    if (replaysGopCache() && HlmIngestManager::getInstance().isPinned(stream_url_)) {
+        ingest_subscriber_ = make_shared<HlmIngestSubscriber>(true, false, keyframesOnly(), true);
+    } else if (keyframesOnly()) {
+        // 只需要关键帧时订阅关键帧压缩包并自行解码，不使用会话的全量解码
+        ingest_subscriber_ = make_shared<HlmIngestSubscriber>(true, false, true);
+    } else {
+        ingest_subscriber_ = make_shared<HlmIngestSubscriber>(!needsDecodedVideo(), needsDecodedVideo());
+    }
+    ingest_session_ = HlmIngestManager::getInstance().acquire(stream_url_, ingest_subscriber_);
+    if (!ingest_session_) {
+        hlm_error("Failed to open shared ingest for stream: {}", stream_url_);
+        ingest_subscriber_.reset();
+        return false;
+    }
+
+    input_format_context_ = ingest_session_->getFormatContext();
+    hlm_info("Subscribed to shared ingest for stream: {}", stream_url_);
+    return true;
+}
+
+HlmInputResult HlmExecutor::readInput(AVPacket* packet, AVFrame* frame) {
+    if (!ingest_session_) {
+        return av_read_frame(input_format_context_, packet) >= 0 ? HlmInputResult::Packet : HlmInputResult::End;
+    }
+
+    HlmIngestItem item;
+    while (isRunning()) {
+        if (!ingest_subscriber_->pop(item, INGEST_POP_TIMEOUT_MS)) {
+            continue;
+        }
+
+        if (item.packet) {
+            av_packet_unref(packet);
+            av_packet_move_ref(packet, item.packet);
+            av_packet_free(&item.packet);
+            return HlmInputResult::Packet;
+        }
+
+        if (item.frame && frame) {
+            av_frame_unref(frame);
+            av_frame_move_ref(frame, item.frame);
+            av_frame_free(&item.frame);
+            return HlmInputResult::Frame;
+        }
+
+        if (item.frame) {
+            av_frame_free(&item.frame);
+            continue;
+        }
+        return HlmInputResult::End;
+    }
+    return HlmInputResult::End;
+}
+
+bool HlmExecutor::readPacket(AVPacket* packet) {
+    return readInput(packet, nullptr) == HlmInputResult::Packet;
+}
+
+bool HlmExecutor::reconnectInput() {
+    int max_retries = CONF.getReconnectMaxRetries();
+    int64_t backoff_ms = CONF.getReconnectBackoffInitialMs();
+    for (int attempt = 1; attempt <= max_retries && isRunning(); attempt++) {
+        hlm_warn("Input dropped for stream: {}, reconnecting in {}ms ({}/{})", stream_url_, backoff_ms, attempt, max_retries);
+        // 分段等待，任务停止时不必等完整个退避间隔
+        int64_t wake_time = getCurrentTimeInMicroseconds() + backoff_ms * 1000;
+        while (isRunning() && getCurrentTimeInMicroseconds() < wake_time) {
+            this_thread::sleep_for(chrono::milliseconds(min<int64_t>(INGEST_POP_TIMEOUT_MS, backoff_ms)));
+        }
+        if (!isRunning()) {
+            break;
+        }
+
+        // 重新打开时探测缓存命中上一次的流信息，只做最小探测
+        closeInput();
+        if (openInputStream() && findStreams()) {
+            hlm_info("Reconnected to stream: {} after {} attempts", stream_url_, attempt);
+            return true;
+        }
+        backoff_ms = min(backoff_ms * 2, CONF.getReconnectBackoffMaxMs());
+    }
+    return false;
+}
+
+void HlmExecutor::closeInput() {
+    if (ingest_session_) {
+        // 共享拉流会话的输入由会话管理，最后一个订阅者退出时关闭
+        input_format_context_ = nullptr;
+        HlmIngestManager::getInstance().release(ingest_session_, ingest_subscriber_);
+        ingest_session_.reset();
+        ingest_subscriber_.reset();
+    }
+
+    if (input_format_context_) {
+        avformat_close_input(&input_format_context_);
+        input_format_context_ = nullptr;
+    }
+    input_video_stream_index_ = -1;
+    input_audio_stream_index_ = -1;
+}
+
 int HlmExecutor::interruptCallback(void* ctx) {
     HlmExecutor* executor = static_cast<HlmExecutor*>(ctx);
 
@@ -164,7 +338,7 @@ int HlmExecutor::interruptCallback(void* ctx) {
         int64_t total_elapsed_time = current_time - executor->start_time_;
         hlm_debug("Interrupt callback invoked: Total elapsed time: {}µs, Start time: {}µs, Current time: {}µs",
                   total_elapsed_time, executor->start_time_, current_time);
-        if (total_elapsed_time > TIMEOUT) {
+        if (total_elapsed_time > CONF.getReadTimeoutUs()) {
             hlm_error("Timeout reached for stream: {}", executor->stream_url_);
             return 1;
         }
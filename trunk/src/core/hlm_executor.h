@@ -9,6 +9,9 @@
 
 #include "hlm_decoder.h"
 #include "hlm_encoder.h"
+#include "hlm_file_writer.h"
+#include "hlm_ingest.h"
+#include "utils/hlm_config.h"
 #include "utils/hlm_queue.h"
 #include "utils/hlm_thread.h"
 
@@ -19,11 +22,14 @@ const string Interval = "interval";
 const string Percentage = "percentage";
 const string Immediate = "immediate";
 const string SpecificTime = "specific_time";
+const string Storyboard = "storyboard";
+const string SceneChange = "scene_change";
 }  // namespace HlmScreenshotMethod
 
 namespace HlmRecordingMethod {
 const string Hls = "hls";
 const string Mp4 = "mp4";
+const string Fmp4 = "fmp4";  // 分片 MP4，录制过程中文件即可播放，异常退出也不会损坏
 }  // namespace HlmRecordingMethod
 
 namespace HlmMixMethod {
@@ -36,6 +42,13 @@ enum class MediaType {
     Mix
 };
 
+// 读取输入的结果：得到一个压缩包、得到一帧共享拉流会话解码后的视频帧、输入结束
+enum class HlmInputResult {
+    Packet,
+    Frame,
+    End
+};
+
 // 通用的 HlmExecutor 基类
 class HlmExecutor {
    public:
@@ -55,9 +68,32 @@ class HlmExecutor {
     bool findStreams();
     bool initDecoder();
     bool initScaler();
+    void setDecoderThreading(const HlmDecoderThreading& threading);
 
     void updateStartTime();
 
+   protected:
+    // 需要解码后的视频帧时返回 true，使用共享拉流会话时由会话统一解码
+    virtual bool needsDecodedVideo() const { return false; }
+    // 只需要视频关键帧时返回 true，解复用层丢弃其他流，解码器跳过非关键帧
+    virtual bool keyframesOnly() const { return false; }
+    virtual bool needsAudioDecoder() const { return true; }
+    // 从常驻流缓存的 GOP 开始解码时返回 true，用于需要尽快得到第一帧的任务
+    virtual bool replaysGopCache() const { return false; }
+    // 文件输入和视频解码器可以从输入池取出、结束后归还时返回 true
+    virtual bool usesInputPool() const { return false; }
+    // 未命中探测缓存时的 probesize/analyzeduration
+    virtual const ProbeSettings& probeSettings() const { return CONF.getDefaultProbe(); }
+    // 需要尽快输出第一帧时返回 true，解码线程策略据此选择片级多线程
+    virtual bool lowLatency() const { return false; }
+    bool useSharedIngest() const;
+    bool openSharedIngest();
+    HlmInputResult readInput(AVPacket* packet, AVFrame* frame);
+    bool readPacket(AVPacket* packet);
+    // 实时流断流后按退避间隔重新打开输入，超过重连次数或任务停止时返回 false
+    bool reconnectInput();
+    void closeInput();
+
    private:
     static int interruptCallback(void* ctx);
 
@@ -74,6 +110,13 @@ class HlmExecutor {
     HlmDecoder* audio_decoder_ = nullptr;
     HlmEncoder* video_encoder_ = nullptr;
     HlmEncoder* audio_encoder_ = nullptr;
+    bool owns_video_decoder_ = true;
+    string input_pool_key_;  // 非空时输入和视频解码器在任务结束后归还输入池
+    HlmDecoderThreading decoder_threading_;
+    bool decoding_started_ = false;  // 已计入正在解码的任务数
+    shared_ptr<HlmIngestSession> ingest_session_;
+    shared_ptr<HlmIngestSubscriber> ingest_subscriber_;
+    shared_ptr<HlmWriteBacklog> write_backlog_;  // 本任务在异步写入服务中的积压
     int input_video_stream_index_ = -1;
     int input_audio_stream_index_ = -1;
     int output_video_stream_index_ = -1;
@@ -85,7 +128,7 @@ class HlmExecutor {
     int64_t start_time_ = 0;
     int64_t last_checked_time_ = 0;
     static const int64_t CHECK_INTERVAL = 1000000;  // 1秒检查间隔
-    static const int64_t TIMEOUT = 3000000;         // 超时3秒
+    static const int64_t INGEST_POP_TIMEOUT_MS = 100;  // 等待共享拉流数据的超时，超时后检查任务是否已停止
 };
 
 #endif  // HLM_EXECUTOR_H
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "hlm_file_writer.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+#include "utils/hlm_time.h"
+
+// 自定义 AVIOContext 的写入位置
+struct HlmAvioOpaque {
+    shared_ptr<HlmWriteFile> file;
+    int64_t position = 0;
+    int64_t size = 0;
+};
+
+HlmWriteBacklog::HlmWriteBacklog(const string& owner, int64_t max_bytes)
+    : owner_(owner), max_bytes_(max_bytes) {}
+
+bool HlmWriteBacklog::reserve(int64_t bytes, HlmWritePolicy policy) {
+    unique_lock<mutex> lock(mutex_);
+    // 积压为空时总是允许写入，保证超过上限的单个数据块也能写出
+    auto has_room = [this, bytes]() { return pending_bytes_ == 0 || pending_bytes_ + bytes <= max_bytes_; };
+    if (policy == HlmWritePolicy::Drop) {
+        if (!has_room()) {
+            return false;
+        }
+    } else if (!has_room()) {
+        hlm_warn("Write backlog of {} is full ({} bytes pending), waiting for disk.", owner_, pending_bytes_);
+        cond_var_.wait(lock, has_room);
+    }
+    pending_bytes_ += bytes;
+    return true;
+}
+
+void HlmWriteBacklog::release(int64_t bytes) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        pending_bytes_ -= bytes;
+    }
+    cond_var_.notify_all();
+}
+
+int64_t HlmWriteBacklog::pendingBytes() const {
+    lock_guard<mutex> lock(mutex_);
+    return pending_bytes_;
+}
+
+HlmWriteFile::HlmWriteFile(const string& path, shared_ptr<HlmWriteBacklog> backlog)
+    : path_(path), backlog_(move(backlog)) {}
+
+HlmWriteFile::~HlmWriteFile() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    for (auto& op : ops_) {
+        av_buffer_unref(&op.buffer);
+    }
+}
+
+HlmFileWriter& HlmFileWriter::getInstance() {
+    static HlmFileWriter instance;
+    return instance;
+}
+
+HlmFileWriter::HlmFileWriter()
+    : pool_(make_unique<HlmThreadPool>("file writer", CONF.getWriterThreads())),
+      task_backlog_bytes_(CONF.getWriterTaskBacklogBytes()) {
+    stats_.workers = CONF.getWriterThreads();
+}
+
+shared_ptr<HlmWriteBacklog> HlmFileWriter::createBacklog(const string& owner) {
+    return make_shared<HlmWriteBacklog>(owner, task_backlog_bytes_);
+}
+
+shared_ptr<HlmWriteFile> HlmFileWriter::openFile(const string& path, shared_ptr<HlmWriteBacklog> backlog) {
+    // 文件在第一次写入时由写入线程打开，打开文件同样不阻塞调用方
+    return make_shared<HlmWriteFile>(path, move(backlog));
+}
+
+bool HlmFileWriter::write(const shared_ptr<HlmWriteFile>& file, int64_t offset, AVBufferRef* buffer, const uint8_t* data, size_t size, HlmWritePolicy policy) {
+    if (file->failed_ || !file->backlog_->reserve(size, policy)) {
+        av_buffer_unref(&buffer);
+        lock_guard<mutex> lock(stats_mutex_);
+        stats_.dropped_writes++;
+        return false;
+    }
+
+    {
+        lock_guard<mutex> lock(stats_mutex_);
+        stats_.submitted_writes++;
+        stats_.pending_bytes += size;
+    }
+
+    HlmWriteFile::Op op;
+    op.buffer = buffer;
+    op.data = data;
+    op.size = size;
+    op.offset = offset;
+    op.submit_time = getCurrentTimeInMicroseconds();
+    enqueue(file, op);
+    return true;
+}
+
+void HlmFileWriter::close(const shared_ptr<HlmWriteFile>& file, bool wait) {
+    HlmWriteFile::Op op;
+    op.close = true;
+    op.submit_time = getCurrentTimeInMicroseconds();
+    enqueue(file, op);
+
+    if (wait) {
+        unique_lock<mutex> lock(file->mutex_);
+        file->closed_cond_.wait(lock, [&file]() { return file->closed_; });
+    }
+}
+
+bool HlmFileWriter::writeFile(const string& path, shared_ptr<HlmWriteBacklog> backlog, AVBufferRef* buffer, const uint8_t* data, size_t size, HlmWritePolicy policy) {
+    auto file = openFile(path, move(backlog));
+    if (!write(file, 0, buffer, data, size, policy)) {
+        return false;
+    }
+    close(file, false);
+    return true;
+}
+
+void HlmFileWriter::enqueue(const shared_ptr<HlmWriteFile>& file, HlmWriteFile::Op op) {
+    bool need_schedule = false;
+    {
+        lock_guard<mutex> lock(file->mutex_);
+        file->ops_.push_back(op);
+        if (!file->scheduled_) {
+            file->scheduled_ = true;
+            need_schedule = true;
+        }
+    }
+
+    // 每个文件同一时刻只在一个写入线程上执行，保证写入顺序
+    if (need_schedule) {
+        pool_->submit([this, file]() { processFile(file); });
+    }
+}
+
+void HlmFileWriter::processFile(shared_ptr<HlmWriteFile> file) {
+    while (true) {
+        deque<HlmWriteFile::Op> ops;
+        {
+            lock_guard<mutex> lock(file->mutex_);
+            if (file->ops_.empty()) {
+                file->scheduled_ = false;
+                return;
+            }
+            ops.swap(file->ops_);
+        }
+
+        size_t i = 0;
+        while (i < ops.size()) {
+            if (ops[i].close) {
+                if (file->fd_ >= 0) {
+                    ::close(file->fd_);
+                    file->fd_ = -1;
+                }
+                {
+                    lock_guard<mutex> lock(file->mutex_);
+                    file->closed_ = true;
+                }
+                file->closed_cond_.notify_all();
+                i++;
+                continue;
+            }
+
+            // 偏移连续的写操作合并成一次 pwritev 提交
+            struct iovec iov[MAX_BATCH_IOVECS];
+            int iovcnt = 0;
+            size_t end = i;
+            int64_t next_offset = ops[i].offset;
+            while (end < ops.size() && !ops[end].close && ops[end].offset == next_offset && iovcnt < MAX_BATCH_IOVECS) {
+                iov[iovcnt].iov_base = const_cast<uint8_t*>(ops[end].data);
+                iov[iovcnt].iov_len = ops[end].size;
+                iovcnt++;
+                next_offset += ops[end].size;
+                end++;
+            }
+
+            bool success = writeBatch(file.get(), ops[i].offset, iov, iovcnt);
+            recordWrites(ops, i, end, success);
+            for (size_t k = i; k < end; k++) {
+                file->backlog_->release(ops[k].size);
+                av_buffer_unref(&ops[k].buffer);
+            }
+            i = end;
+        }
+    }
+}
+
+bool HlmFileWriter::writeBatch(HlmWriteFile* file, int64_t offset, struct iovec* iov, int iovcnt) {
+    if (file->failed_) {
+        return false;
+    }
+
+    if (file->fd_ < 0) {
+        file->fd_ = ::open(file->path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file->fd_ < 0) {
+            hlm_error("Failed to open file for writing: {}. Error: {}", file->path_, strerror(errno));
+            file->failed_ = true;
+            return false;
+        }
+    }
+
+    while (iovcnt > 0) {
+        ssize_t written = pwritev(file->fd_, iov, iovcnt, offset);
+        {
+            lock_guard<mutex> lock(stats_mutex_);
+            stats_.write_syscalls++;
+        }
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            hlm_error("Failed to write file: {}. Error: {}", file->path_, strerror(errno));
+            file->failed_ = true;
+            return false;
+        }
+
+        // 处理部分写入，从未写完的数据块继续
+        offset += written;
+        while (iovcnt > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+void HlmFileWriter::recordWrites(const deque<HlmWriteFile::Op>& ops, size_t begin, size_t end, bool success) {
+    int64_t now = getCurrentTimeInMicroseconds();
+    lock_guard<mutex> lock(stats_mutex_);
+    for (size_t i = begin; i < end; i++) {
+        int64_t latency_ms = (now - ops[i].submit_time) / 1000;
+        size_t bucket = lower_bound(LATENCY_BUCKET_BOUNDS_MS.begin(), LATENCY_BUCKET_BOUNDS_MS.end(), latency_ms) - LATENCY_BUCKET_BOUNDS_MS.begin();
+        stats_.latency_histogram[bucket]++;
+        stats_.pending_bytes -= ops[i].size;
+        if (success) {
+            stats_.completed_writes++;
+        } else {
+            stats_.failed_writes++;
+        }
+    }
+}
+
+HlmFileWriterStats HlmFileWriter::getStats() const {
+    lock_guard<mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+string HlmFileWriter::latencyBucketLabel(size_t bucket) {
+    if (bucket < LATENCY_BUCKET_BOUNDS_MS.size()) {
+        return "le_" + to_string(LATENCY_BUCKET_BOUNDS_MS[bucket]) + "ms";
+    }
+    return "gt_" + to_string(LATENCY_BUCKET_BOUNDS_MS.back()) + "ms";
+}
+
+AVIOContext* HlmFileWriter::openAvio(const string& path, shared_ptr<HlmWriteBacklog> backlog) {
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(AVIO_BUFFER_SIZE));
+    if (!buffer) {
+        hlm_error("Failed to allocate AVIO buffer for: {}", path);
+        return nullptr;
+    }
+
+    HlmAvioOpaque* opaque = new HlmAvioOpaque();
+    opaque->file = openFile(path, move(backlog));
+    AVIOContext* pb = avio_alloc_context(buffer, AVIO_BUFFER_SIZE, 1, opaque, nullptr, avioWritePacket, avioSeek);
+    if (!pb) {
+        hlm_error("Failed to allocate AVIO context for: {}", path);
+        av_free(buffer);
+        delete opaque;
+        return nullptr;
+    }
+    return pb;
+}
+
+void HlmFileWriter::closeAvio(AVIOContext** pb, bool wait) {
+    if (!pb || !*pb) {
+        return;
+    }
+
+    avio_flush(*pb);
+    HlmAvioOpaque* opaque = static_cast<HlmAvioOpaque*>((*pb)->opaque);
+    close(opaque->file, wait);
+    delete opaque;
+
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+}
+
+void HlmFileWriter::bindFormatContext(AVFormatContext* format_context, shared_ptr<HlmWriteBacklog> backlog) {
+    format_context->opaque = backlog.get();
+    format_context->io_open = ioOpen;
+    format_context->io_close2 = ioClose;
+}
+
+int HlmFileWriter::avioWritePacket(void* opaque, uint8_t* buf, int buf_size) {
+    HlmAvioOpaque* avio_opaque = static_cast<HlmAvioOpaque*>(opaque);
+    if (avio_opaque->file->hasFailed()) {
+        return AVERROR(EIO);
+    }
+
+    // AVIOContext 会复用自己的缓冲区，写入服务需要持有一份拷贝
+    AVBufferRef* buffer = av_buffer_alloc(buf_size);
+    if (!buffer) {
+        return AVERROR(ENOMEM);
+    }
+    memcpy(buffer->data, buf, buf_size);
+
+    getInstance().write(avio_opaque->file, avio_opaque->position, buffer, buffer->data, buf_size, HlmWritePolicy::Block);
+    avio_opaque->position += buf_size;
+    avio_opaque->size = max(avio_opaque->size, avio_opaque->position);
+    return buf_size;
+}
+
+int64_t HlmFileWriter::avioSeek(void* opaque, int64_t offset, int whence) {
+    HlmAvioOpaque* avio_opaque = static_cast<HlmAvioOpaque*>(opaque);
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return avio_opaque->size;
+        case SEEK_SET:
+            avio_opaque->position = offset;
+            break;
+        case SEEK_CUR:
+            avio_opaque->position += offset;
+            break;
+        case SEEK_END:
+            avio_opaque->position = avio_opaque->size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    return avio_opaque->position;
+}
+
+int HlmFileWriter::ioOpen(AVFormatContext* s, AVIOContext** pb, const char* url, int flags, AVDictionary** options) {
+    // 只接管写入，读取仍使用 FFmpeg 默认实现
+    if (flags & AVIO_FLAG_READ) {
+        return avio_open2(pb, url, flags, &s->interrupt_callback, options);
+    }
+
+    HlmWriteBacklog* backlog = static_cast<HlmWriteBacklog*>(s->opaque);
+    *pb = getInstance().openAvio(url, backlog->shared_from_this());
+    return *pb ? 0 : AVERROR(ENOMEM);
+}
+
+int HlmFileWriter::ioClose(AVFormatContext* s, AVIOContext* pb) {
+    if (pb->write_packet != avioWritePacket) {
+        return avio_close(pb);
+    }
+
+    // HLS 播放列表先写入 .tmp 文件再重命名，必须等待写完后再返回
+    HlmAvioOpaque* avio_opaque = static_cast<HlmAvioOpaque*>(pb->opaque);
+    const string& path = avio_opaque->file->getPath();
+    bool wait = path.size() > 4 && path.compare(path.size() - 4, 4, ".tmp") == 0;
+    getInstance().closeAvio(&pb, wait);
+    return 0;
+}
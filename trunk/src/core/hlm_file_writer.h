@@ -0,0 +1,140 @@
+#ifndef HLM_FILE_WRITER_H
+#define HLM_FILE_WRITER_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/buffer.h>
+}
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "utils/hlm_thread_pool.h"
+
+using namespace std;
+
+// 任务写入积压已满时的处理方式
+enum class HlmWritePolicy {
+    Drop,  // 丢弃本次写入，用于截图等可以丢失的数据
+    Block  // 等待积压下降，用于录制等必须完整写入的数据
+};
+
+static const size_t HLM_WRITE_LATENCY_BUCKETS = 9;
+
+struct HlmFileWriterStats {
+    size_t workers = 0;              // 写入线程数
+    uint64_t submitted_writes = 0;   // 提交的写操作数
+    uint64_t completed_writes = 0;   // 成功落盘的写操作数
+    uint64_t failed_writes = 0;      // 写入失败的写操作数
+    uint64_t dropped_writes = 0;     // 积压已满被丢弃的写操作数
+    uint64_t write_syscalls = 0;     // 合并后实际执行的写系统调用数
+    int64_t pending_bytes = 0;       // 尚未落盘的字节数
+    array<uint64_t, HLM_WRITE_LATENCY_BUCKETS> latency_histogram{};  // 从提交到落盘的延迟分布
+};
+
+// 一个任务的写入积压，限制该任务尚未落盘的字节数，磁盘卡顿时不会无限占用内存
+class HlmWriteBacklog : public enable_shared_from_this<HlmWriteBacklog> {
+   public:
+    HlmWriteBacklog(const string& owner, int64_t max_bytes);
+
+    bool reserve(int64_t bytes, HlmWritePolicy policy);
+    void release(int64_t bytes);
+    int64_t pendingBytes() const;
+    const string& getOwner() const { return owner_; }
+
+   private:
+    string owner_;
+    int64_t max_bytes_;
+    int64_t pending_bytes_ = 0;
+    mutable mutex mutex_;
+    condition_variable cond_var_;
+};
+
+// 由写入服务执行的输出文件，同一文件的写操作按提交顺序执行，不同文件在写入线程上并行
+class HlmWriteFile {
+   public:
+    HlmWriteFile(const string& path, shared_ptr<HlmWriteBacklog> backlog);
+    ~HlmWriteFile();
+
+    const string& getPath() const { return path_; }
+    bool hasFailed() const { return failed_; }
+
+   private:
+    friend class HlmFileWriter;
+
+    struct Op {
+        AVBufferRef* buffer = nullptr;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        int64_t offset = 0;
+        bool close = false;
+        int64_t submit_time = 0;
+    };
+
+    string path_;
+    shared_ptr<HlmWriteBacklog> backlog_;
+    int fd_ = -1;
+    atomic<bool> failed_{false};
+
+    mutex mutex_;
+    condition_variable closed_cond_;
+    deque<Op> ops_;
+    bool scheduled_ = false;
+    bool closed_ = false;
+};
+
+// 进程级的异步文件写入服务：调用方把编码后的数据交给写入服务后立即返回，解码和拉流线程不再被磁盘阻塞
+class HlmFileWriter {
+   public:
+    static HlmFileWriter& getInstance();
+
+    shared_ptr<HlmWriteBacklog> createBacklog(const string& owner);
+    shared_ptr<HlmWriteFile> openFile(const string& path, shared_ptr<HlmWriteBacklog> backlog);
+    // 写入服务接管 buffer 的引用，落盘或丢弃后释放
+    bool write(const shared_ptr<HlmWriteFile>& file, int64_t offset, AVBufferRef* buffer, const uint8_t* data, size_t size, HlmWritePolicy policy);
+    void close(const shared_ptr<HlmWriteFile>& file, bool wait);
+    // 整个文件一次写入，用于截图
+    bool writeFile(const string& path, shared_ptr<HlmWriteBacklog> backlog, AVBufferRef* buffer, const uint8_t* data, size_t size, HlmWritePolicy policy);
+
+    // 录制通过自定义 AVIOContext 写入
+    AVIOContext* openAvio(const string& path, shared_ptr<HlmWriteBacklog> backlog);
+    void closeAvio(AVIOContext** pb, bool wait);
+    // 复用器自行打开的文件（如 HLS 切片和播放列表）也交给写入服务
+    void bindFormatContext(AVFormatContext* format_context, shared_ptr<HlmWriteBacklog> backlog);
+
+    HlmFileWriterStats getStats() const;
+    static string latencyBucketLabel(size_t bucket);
+
+   private:
+    HlmFileWriter();
+    HlmFileWriter(const HlmFileWriter&) = delete;
+    HlmFileWriter& operator=(const HlmFileWriter&) = delete;
+
+    void enqueue(const shared_ptr<HlmWriteFile>& file, HlmWriteFile::Op op);
+    void processFile(shared_ptr<HlmWriteFile> file);
+    bool writeBatch(HlmWriteFile* file, int64_t offset, struct iovec* iov, int iovcnt);
+    void recordWrites(const deque<HlmWriteFile::Op>& ops, size_t begin, size_t end, bool success);
+
+    static int avioWritePacket(void* opaque, uint8_t* buf, int buf_size);
+    static int64_t avioSeek(void* opaque, int64_t offset, int whence);
+    static int ioOpen(AVFormatContext* s, AVIOContext** pb, const char* url, int flags, AVDictionary** options);
+    static int ioClose(AVFormatContext* s, AVIOContext* pb);
+
+    unique_ptr<HlmThreadPool> pool_;
+    int64_t task_backlog_bytes_;
+
+    mutable mutex stats_mutex_;
+    HlmFileWriterStats stats_;
+
+    static constexpr int MAX_BATCH_IOVECS = 64;     // 一次合并写入的最大数据块数
+    static const int AVIO_BUFFER_SIZE = 64 * 1024;  // 自定义 AVIOContext 的缓冲区大小
+    static constexpr array<int64_t, HLM_WRITE_LATENCY_BUCKETS - 1> LATENCY_BUCKET_BOUNDS_MS = {1, 5, 10, 50, 100, 500, 1000, 5000};
+};
+
+#endif  // HLM_FILE_WRITER_H
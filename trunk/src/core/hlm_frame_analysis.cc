@@ -0,0 +1,72 @@
+#include "hlm_frame_analysis.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "utils/hlm_logger.h"
+#include "utils/hlm_simd.h"
+
+HlmLumaSampler::HlmLumaSampler(int width, int height)
+    : width_(width), height_(height) {}
+
+HlmLumaSampler::~HlmLumaSampler() {
+    if (sws_ctx_) {
+        sws_freeContext(sws_ctx_);
+        sws_ctx_ = nullptr;
+    }
+}
+
+bool HlmLumaSampler::sample(const AVFrame* frame, vector<uint8_t>& luma) {
+    // 输入分辨率或像素格式变化时 sws_getCachedContext 会重建上下文
+    sws_ctx_ = sws_getCachedContext(sws_ctx_, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                    width_, height_, AV_PIX_FMT_GRAY8, SWS_AREA, nullptr, nullptr, nullptr);
+    if (!sws_ctx_) {
+        hlm_error("Failed to initialize luma sampler for {}x{}.", frame->width, frame->height);
+        return false;
+    }
+
+    luma.resize(static_cast<size_t>(width_) * height_);
+    uint8_t* dst_data[4] = {luma.data(), nullptr, nullptr, nullptr};
+    int dst_linesize[4] = {width_, 0, 0, 0};
+    sws_scale(sws_ctx_, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
+    return true;
+}
+
+double HlmSharpnessMeter::measure(const AVFrame* frame) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    bool direct_luma = desc && !(desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)) &&
+                       desc->comp[0].plane == 0 && desc->comp[0].depth == 8 && desc->comp[0].step == 1;
+    if (direct_luma) {
+        return hlmLaplacianVariance(frame->data[0], frame->linesize[0], frame->width, frame->height);
+    }
+
+    if (!sampler_ || sampler_->getWidth() != frame->width || sampler_->getHeight() != frame->height) {
+        sampler_ = make_unique<HlmLumaSampler>(frame->width, frame->height);
+    }
+    if (!sampler_->sample(frame, luma_)) {
+        return 0;
+    }
+    return hlmLaplacianVariance(luma_.data(), frame->width, frame->width, frame->height);
+}
+
+double hlmMeanAbsDiff(const vector<uint8_t>& a, const vector<uint8_t>& b) {
+    if (a.empty() || a.size() != b.size()) {
+        return 255.0;
+    }
+    return static_cast<double>(hlmSumAbsDiff(a.data(), b.data(), a.size())) / a.size();
+}
+
+uint64_t hlmDifferenceHash(const vector<uint8_t>& luma) {
+    uint64_t hash = 0;
+    if (luma.size() != static_cast<size_t>(HLM_DHASH_WIDTH) * HLM_DHASH_HEIGHT) {
+        return hash;
+    }
+    for (int y = 0; y < HLM_DHASH_HEIGHT; ++y) {
+        const uint8_t* row = luma.data() + y * HLM_DHASH_WIDTH;
+        for (int x = 0; x < HLM_DHASH_WIDTH - 1; ++x) {
+            hash = (hash << 1) | (row[x] > row[x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
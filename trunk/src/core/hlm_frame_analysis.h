@@ -0,0 +1,52 @@
+#ifndef HLM_FRAME_ANALYSIS_H
+#define HLM_FRAME_ANALYSIS_H
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// 把解码帧缩小成固定尺寸的亮度平面，用于场景检测等只需要粗略画面的分析
+class HlmLumaSampler {
+   public:
+    HlmLumaSampler(int width, int height);
+    ~HlmLumaSampler();
+
+    bool sample(const AVFrame* frame, vector<uint8_t>& luma);
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+
+   private:
+    int width_;
+    int height_;
+    SwsContext* sws_ctx_ = nullptr;
+};
+
+// 画面清晰度：亮度平面拉普拉斯响应的方差。YUV 和灰度帧直接使用原始亮度平面，其他格式先转成灰度
+class HlmSharpnessMeter {
+   public:
+    double measure(const AVFrame* frame);
+
+   private:
+    unique_ptr<HlmLumaSampler> sampler_;
+    vector<uint8_t> luma_;
+};
+
+// 两个亮度平面每像素的平均绝对差，取值 0-255
+double hlmMeanAbsDiff(const vector<uint8_t>& a, const vector<uint8_t>& b);
+
+// 64 位差值哈希（dHash）：亮度平面为 9x8，每行相邻像素比较得到 8 位
+static const int HLM_DHASH_WIDTH = 9;
+static const int HLM_DHASH_HEIGHT = 8;
+uint64_t hlmDifferenceHash(const vector<uint8_t>& luma);
+
+// 两个哈希不同的位数，取值 0-64，越小画面越相似
+inline int hlmHammingDistance(uint64_t a, uint64_t b) { return __builtin_popcountll(a ^ b); }
+
+#endif  // HLM_FRAME_ANALYSIS_H
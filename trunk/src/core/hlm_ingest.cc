@@ -0,0 +1,458 @@
+#include "hlm_ingest.h"
+
+#include "hlm_probe_cache.h"
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+#include "utils/hlm_time.h"
+
+namespace {
+// 订阅者队列上限，消费过慢时丢弃新数据，避免内存无限增长
+const size_t kMaxQueuedItems = 2048;
+const size_t kMaxQueuedFrames = 8;
+}  // namespace
+
+HlmIngestSubscriber::HlmIngestSubscriber(bool need_packets, bool need_video_frames, bool video_keyframes_only, bool replay_gop)
+    : need_packets_(need_packets), need_video_frames_(need_video_frames), video_keyframes_only_(video_keyframes_only), replay_gop_(replay_gop) {}
+
+HlmIngestSubscriber::~HlmIngestSubscriber() {
+    HlmIngestItem item;
+    while (queue_.tryPop(item, 0)) {
+        av_packet_free(&item.packet);
+        av_frame_free(&item.frame);
+    }
+}
+
+bool HlmIngestSubscriber::acceptPacket(const AVPacket* packet, int video_stream_index) {
+    // 中途加入的订阅者从视频关键帧开始接收，保证输出可以正常解码
+    bool is_video_key = packet->stream_index == video_stream_index && (packet->flags & AV_PKT_FLAG_KEY);
+    if (video_keyframes_only_) {
+        return is_video_key;
+    }
+
+    if (!started_ && is_video_key) {
+        started_ = true;
+    }
+    return started_ || video_stream_index < 0;
+}
+
+bool HlmIngestSubscriber::pop(HlmIngestItem& item, int64_t timeout_ms) {
+    return queue_.tryPop(item, timeout_ms);
+}
+
+void HlmIngestSubscriber::push(const HlmIngestItem& item) {
+    size_t limit = item.frame ? kMaxQueuedFrames : kMaxQueuedItems;
+    if (queue_.size() >= limit) {
+        HlmIngestItem dropped = item;
+        av_packet_free(&dropped.packet);
+        av_frame_free(&dropped.frame);
+        hlm_warn("Ingest subscriber queue is full ({} items), dropping {}.", limit, item.frame ? "frame" : "packet");
+        return;
+    }
+    queue_.push(item);
+}
+
+void HlmIngestSubscriber::pushEnd() {
+    queue_.push(HlmIngestItem());
+}
+
+HlmIngestSession::HlmIngestSession(const string& stream_url) : stream_url_(stream_url) {}
+
+HlmIngestSession::~HlmIngestSession() {
+    close();
+}
+
+bool HlmIngestSession::open() {
+    lock_guard<mutex> open_lock(open_mutex_);
+    if (opened_) {
+        return true;
+    }
+    if (open_failed_) {
+        return false;
+    }
+
+    format_context_ = avformat_alloc_context();
+    if (!format_context_) {
+        hlm_error("Failed to allocate AVFormatContext for ingest: {}", stream_url_);
+        open_failed_ = true;
+        return false;
+    }
+
+    running_ = true;
+    last_read_time_ = getCurrentTimeInMicroseconds();
+    format_context_->interrupt_callback = {interruptCallback, this};
+
+    if (avformat_open_input(&format_context_, stream_url_.c_str(), nullptr, nullptr) != 0) {
+        hlm_error("Failed to open ingest stream: {}", stream_url_);
+        running_ = false;
+        open_failed_ = true;
+        return false;
+    }
+    last_read_time_ = getCurrentTimeInMicroseconds();
+
+    // 共享会话同时服务截图和录制，使用通用的探测参数
+    if (!HlmProbeCache::getInstance().probe(format_context_, stream_url_, CONF.getDefaultProbe())) {
+        hlm_error("Failed to retrieve stream info for ingest: {}", stream_url_);
+        running_ = false;
+        open_failed_ = true;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < format_context_->nb_streams; i++) {
+        if (format_context_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            video_stream_index_ = i;
+            break;
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        opened_ = true;
+        updateStreamDiscard();
+    }
+
+    demux_thread_ = make_unique<HlmThread>("ingest " + stream_url_, [this]() { demuxLoop(); });
+    demux_thread_->start();
+    hlm_info("Shared ingest session opened for stream: {}", stream_url_);
+    return true;
+}
+
+void HlmIngestSession::close() {
+    running_ = false;
+    if (demux_thread_) {
+        demux_thread_->stop();
+        demux_thread_.reset();
+    }
+
+    if (video_decoder_) {
+        HlmDecoderThreadingPolicy::decodingFinished();
+        video_decoder_.reset();
+    }
+    {
+        lock_guard<mutex> lock(mutex_);
+        gop_cache_enabled_ = false;
+        clearGopCache();
+    }
+    if (format_context_) {
+        avformat_close_input(&format_context_);
+        format_context_ = nullptr;
+    }
+}
+
+bool HlmIngestSession::isEnded() const {
+    return ended_ || open_failed_;
+}
+
+void HlmIngestSession::subscribe(shared_ptr<HlmIngestSubscriber> subscriber) {
+    lock_guard<mutex> lock(mutex_);
+    subscribers_.push_back(subscriber);
+    updateStreamDiscard();
+    hlm_info("Subscriber joined ingest session: {}. Subscribers: {}", stream_url_, subscribers_.size());
+
+    // 缓存和分发在同一把锁下更新，回放的 GOP 与之后分发的压缩包既不重复也不遗漏
+    if (subscriber->replaysGop() && subscriber->needPackets() && !gop_cache_.empty()) {
+        for (AVPacket* packet : gop_cache_) {
+            if (subscriber->acceptPacket(packet, video_stream_index_)) {
+                HlmIngestItem item;
+                item.packet = av_packet_clone(packet);
+                subscriber->push(item);
+            }
+        }
+        hlm_info("Replayed {} cached packets ({} bytes) of {} to new subscriber.", gop_cache_.size(), gop_cache_bytes_, stream_url_);
+    }
+}
+
+size_t HlmIngestSession::unsubscribe(shared_ptr<HlmIngestSubscriber> subscriber) {
+    lock_guard<mutex> lock(mutex_);
+    subscribers_.erase(remove(subscribers_.begin(), subscribers_.end(), subscriber), subscribers_.end());
+    updateStreamDiscard();
+    hlm_info("Subscriber left ingest session: {}. Subscribers: {}", stream_url_, subscribers_.size());
+    return subscribers_.size();
+}
+
+void HlmIngestSession::setGopCacheEnabled(bool enabled) {
+    lock_guard<mutex> lock(mutex_);
+    gop_cache_enabled_ = enabled;
+    if (!enabled) {
+        clearGopCache();
+    }
+    updateStreamDiscard();
+}
+
+HlmDecoder* HlmIngestSession::acquireVideoDecoder() {
+    lock_guard<mutex> lock(mutex_);
+    if (video_decoder_) {
+        return video_decoder_.get();
+    }
+
+    if (video_stream_index_ < 0) {
+        hlm_error("No video stream to decode in ingest session: {}", stream_url_);
+        return nullptr;
+    }
+
+    // 共享解码器服务所有订阅者，按一个正在解码的任务分配线程
+    HlmDecoderThreadingPolicy::decodingStarted();
+    auto decoder = make_unique<HlmDecoder>(video_stream_index_);
+    if (!decoder->initDecoder(format_context_)) {
+        HlmDecoderThreadingPolicy::decodingFinished();
+        hlm_error("Failed to initialize shared video decoder for ingest: {}", stream_url_);
+        return nullptr;
+    }
+    video_decoder_ = move(decoder);
+    hlm_info("Shared video decoder initialized for ingest: {}, stream index: {}", stream_url_, video_stream_index_);
+    return video_decoder_.get();
+}
+
+void HlmIngestSession::demuxLoop() {
+    AVPacket* packet = av_packet_alloc();
+    while (running_) {
+        last_read_time_ = getCurrentTimeInMicroseconds();
+        int ret = av_read_frame(format_context_, packet);
+        if (ret == AVERROR(EAGAIN)) {
+            continue;
+        } else if (ret < 0) {
+            break;
+        }
+
+        dispatchPacket(packet);
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+
+    HlmDecoder* decoder = nullptr;
+    {
+        lock_guard<mutex> lock(mutex_);
+        decoder = video_decoder_.get();
+    }
+    if (decoder) {
+        decoder->flushDecoder([this](AVFrame* frame, int stream_index) {
+            dispatchFrame(frame);
+        });
+    }
+
+    ended_ = true;
+    dispatchEnd();
+    hlm_info("Shared ingest session ended for stream: {}", stream_url_);
+}
+
+void HlmIngestSession::dispatchPacket(AVPacket* packet) {
+    vector<shared_ptr<HlmIngestSubscriber>> subscribers;
+    HlmDecoder* decoder = nullptr;
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (gop_cache_enabled_ && packet->stream_index == video_stream_index_) {
+            cacheVideoPacket(packet);
+        }
+        subscribers = subscribers_;
+        decoder = video_decoder_.get();
+    }
+
+    for (auto& subscriber : subscribers) {
+        if (subscriber->needPackets() && subscriber->acceptPacket(packet, video_stream_index_)) {
+            HlmIngestItem item;
+            item.packet = av_packet_clone(packet);
+            subscriber->push(item);
+        }
+    }
+
+    // 所有需要视频帧的订阅者共用一次解码
+    if (decoder && packet->stream_index == video_stream_index_) {
+        decoder->decodePacket(packet, [this](AVFrame* frame, int stream_index) {
+            dispatchFrame(frame);
+        });
+    }
+}
+
+void HlmIngestSession::dispatchFrame(AVFrame* frame) {
+    vector<shared_ptr<HlmIngestSubscriber>> subscribers;
+    {
+        lock_guard<mutex> lock(mutex_);
+        subscribers = subscribers_;
+    }
+
+    for (auto& subscriber : subscribers) {
+        if (subscriber->needVideoFrames()) {
+            HlmIngestItem item;
+            item.frame = av_frame_clone(frame);
+            subscriber->push(item);
+        }
+    }
+}
+
+void HlmIngestSession::dispatchEnd() {
+    lock_guard<mutex> lock(mutex_);
+    for (auto& subscriber : subscribers_) {
+        subscriber->pushEnd();
+    }
+}
+
+void HlmIngestSession::cacheVideoPacket(const AVPacket* packet) {
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        clearGopCache();
+    } else if (gop_cache_.empty()) {
+        return;
+    }
+
+    // GOP 过大时放弃缓存，等待下一个关键帧重新开始
+    if (gop_cache_bytes_ + packet->size > CONF.getGopCacheMaxBytes()) {
+        hlm_debug("GOP of {} exceeds cache limit, waiting for next keyframe.", stream_url_);
+        clearGopCache();
+        return;
+    }
+
+    AVPacket* cached = av_packet_clone(packet);
+    if (cached) {
+        gop_cache_.push_back(cached);
+        gop_cache_bytes_ += cached->size;
+    }
+}
+
+void HlmIngestSession::clearGopCache() {
+    for (AVPacket* packet : gop_cache_) {
+        av_packet_free(&packet);
+    }
+    gop_cache_.clear();
+    gop_cache_bytes_ = 0;
+}
+
+void HlmIngestSession::updateStreamDiscard() {
+    if (!format_context_ || !opened_) {
+        return;
+    }
+
+    // 只有全部订阅者都不消费的流才在解复用层丢弃
+    bool need_all_packets = false;
+    bool need_all_video = gop_cache_enabled_;
+    for (auto& subscriber : subscribers_) {
+        if (subscriber->needPackets() && !subscriber->videoKeyframesOnly()) {
+            need_all_packets = true;
+        }
+        if (subscriber->needVideoFrames()) {
+            need_all_video = true;
+        }
+    }
+
+    for (unsigned int i = 0; i < format_context_->nb_streams; i++) {
+        AVDiscard discard = AVDISCARD_DEFAULT;
+        if (static_cast<int>(i) == video_stream_index_) {
+            discard = (need_all_packets || need_all_video) ? AVDISCARD_DEFAULT : AVDISCARD_NONKEY;
+        } else if (!need_all_packets) {
+            discard = AVDISCARD_ALL;
+        }
+        format_context_->streams[i]->discard = discard;
+    }
+}
+
+int HlmIngestSession::interruptCallback(void* ctx) {
+    HlmIngestSession* session = static_cast<HlmIngestSession*>(ctx);
+    if (!session->running_) {
+        return 1;
+    }
+
+    if (getCurrentTimeInMicroseconds() - session->last_read_time_ > CONF.getReadTimeoutUs()) {
+        hlm_error("Timeout reached for ingest stream: {}", session->stream_url_);
+        return 1;
+    }
+    return 0;
+}
+
+HlmIngestManager& HlmIngestManager::getInstance() {
+    static HlmIngestManager instance;
+    return instance;
+}
+
+shared_ptr<HlmIngestSession> HlmIngestManager::acquire(const string& stream_url, shared_ptr<HlmIngestSubscriber> subscriber) {
+    shared_ptr<HlmIngestSession> session;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = sessions_.find(stream_url);
+        if (it != sessions_.end() && !it->second->isEnded()) {
+            session = it->second;
+        } else {
+            session = make_shared<HlmIngestSession>(stream_url);
+            sessions_[stream_url] = session;
+        }
+        // 在打开之前订阅，保证并发的 release 不会关闭正在打开的会话
+        session->subscribe(subscriber);
+    }
+
+    if (!session->open()) {
+        release(session, subscriber);
+        return nullptr;
+    }
+    return session;
+}
+
+void HlmIngestManager::release(shared_ptr<HlmIngestSession> session, shared_ptr<HlmIngestSubscriber> subscriber) {
+    size_t remaining = 0;
+    {
+        lock_guard<mutex> lock(mutex_);
+        remaining = session->unsubscribe(subscriber);
+        if (remaining == 0) {
+            auto it = sessions_.find(session->getStreamUrl());
+            if (it != sessions_.end() && it->second == session) {
+                sessions_.erase(it);
+            }
+        }
+    }
+
+    if (remaining == 0) {
+        session->close();
+    }
+}
+
+bool HlmIngestManager::pin(const string& stream_url) {
+    lock_guard<mutex> lock(pin_mutex_);
+    auto it = pins_.find(stream_url);
+    if (it != pins_.end()) {
+        if (!it->second.session->isEnded()) {
+            return true;
+        }
+        // 流已结束，释放旧会话后重新拉流
+        release(it->second.session, it->second.subscriber);
+        pins_.erase(it);
+    }
+
+    auto subscriber = make_shared<HlmIngestSubscriber>(false, false);
+    auto session = acquire(stream_url, subscriber);
+    if (!session) {
+        hlm_error("Failed to pin stream: {}", stream_url);
+        return false;
+    }
+    session->setGopCacheEnabled(true);
+    pins_[stream_url] = {session, subscriber};
+    hlm_info("Pinned stream with GOP cache: {}", stream_url);
+    return true;
+}
+
+bool HlmIngestManager::unpin(const string& stream_url) {
+    HlmIngestPin pin;
+    {
+        lock_guard<mutex> lock(pin_mutex_);
+        auto it = pins_.find(stream_url);
+        if (it == pins_.end()) {
+            return false;
+        }
+        pin = it->second;
+        pins_.erase(it);
+    }
+
+    pin.session->setGopCacheEnabled(false);
+    release(pin.session, pin.subscriber);
+    hlm_info("Unpinned stream: {}", stream_url);
+    return true;
+}
+
+bool HlmIngestManager::isPinned(const string& stream_url) {
+    lock_guard<mutex> lock(pin_mutex_);
+    auto it = pins_.find(stream_url);
+    return it != pins_.end() && !it->second.session->isEnded();
+}
+
+vector<string> HlmIngestManager::getPinnedStreams() {
+    lock_guard<mutex> lock(pin_mutex_);
+    vector<string> streams;
+    for (const auto& pin : pins_) {
+        streams.push_back(pin.first);
+    }
+    return streams;
+}
@@ -0,0 +1,130 @@
+#ifndef HLM_INGEST_H
+#define HLM_INGEST_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hlm_decoder.h"
+#include "utils/hlm_queue.h"
+#include "utils/hlm_thread.h"
+
+using namespace std;
+
+// 拉流会话分发给订阅者的数据，packet 和 frame 均为独立引用，由订阅者释放；两者都为空表示流结束
+struct HlmIngestItem {
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+};
+
+// 拉流会话的订阅者，对应一个执行器；video_keyframes_only 时只接收视频关键帧的压缩包；
+// replay_gop 时订阅后先收到会话缓存的当前 GOP，不必等待下一个关键帧
+class HlmIngestSubscriber {
+   public:
+    HlmIngestSubscriber(bool need_packets, bool need_video_frames, bool video_keyframes_only = false, bool replay_gop = false);
+    ~HlmIngestSubscriber();
+
+    bool needPackets() const { return need_packets_; }
+    bool needVideoFrames() const { return need_video_frames_; }
+    bool videoKeyframesOnly() const { return video_keyframes_only_; }
+    bool replaysGop() const { return replay_gop_; }
+    bool acceptPacket(const AVPacket* packet, int video_stream_index);
+    bool pop(HlmIngestItem& item, int64_t timeout_ms);
+    void push(const HlmIngestItem& item);
+    void pushEnd();
+
+   private:
+    bool need_packets_;
+    bool need_video_frames_;
+    bool video_keyframes_only_;
+    bool replay_gop_;
+    bool started_ = false;
+    HlmQueue<HlmIngestItem> queue_;
+};
+
+// 同一 stream_url 的拉流会话：只打开、探测和解复用一次，将引用计数的 AVPacket 分发给所有订阅者；
+// 有订阅者需要视频帧时，由会话统一解码后分发 AVFrame
+class HlmIngestSession {
+   public:
+    HlmIngestSession(const string& stream_url);
+    ~HlmIngestSession();
+
+    bool open();
+    void close();
+    bool isEnded() const;
+
+    void subscribe(shared_ptr<HlmIngestSubscriber> subscriber);
+    size_t unsubscribe(shared_ptr<HlmIngestSubscriber> subscriber);
+    HlmDecoder* acquireVideoDecoder();
+    // 开启后缓存最近一个关键帧起的视频压缩包，不解码
+    void setGopCacheEnabled(bool enabled);
+
+    AVFormatContext* getFormatContext() const { return format_context_; }
+    const string& getStreamUrl() const { return stream_url_; }
+
+   private:
+    void demuxLoop();
+    void dispatchPacket(AVPacket* packet);
+    void dispatchFrame(AVFrame* frame);
+    void dispatchEnd();
+    void cacheVideoPacket(const AVPacket* packet);
+    void clearGopCache();
+    void updateStreamDiscard();
+    static int interruptCallback(void* ctx);
+
+    string stream_url_;
+    AVFormatContext* format_context_ = nullptr;
+    int video_stream_index_ = -1;
+    unique_ptr<HlmDecoder> video_decoder_;
+    unique_ptr<HlmThread> demux_thread_;
+
+    mutex open_mutex_;
+    mutex mutex_;
+    vector<shared_ptr<HlmIngestSubscriber>> subscribers_;
+    bool gop_cache_enabled_ = false;
+    deque<AVPacket*> gop_cache_;  // 从最近一个关键帧开始的视频压缩包
+    int64_t gop_cache_bytes_ = 0;
+    atomic<bool> opened_{false};
+    atomic<bool> open_failed_{false};
+    atomic<bool> running_{false};
+    atomic<bool> ended_{false};
+    atomic<int64_t> last_read_time_{0};
+};
+
+// 按 stream_url 管理拉流会话，最后一个订阅者退出时关闭会话；
+// 常驻的流即使没有任务也保持拉流并缓存当前 GOP，立即截图不需要重新打开和探测
+class HlmIngestManager {
+   public:
+    static HlmIngestManager& getInstance();
+
+    shared_ptr<HlmIngestSession> acquire(const string& stream_url, shared_ptr<HlmIngestSubscriber> subscriber);
+    void release(shared_ptr<HlmIngestSession> session, shared_ptr<HlmIngestSubscriber> subscriber);
+
+    bool pin(const string& stream_url);
+    bool unpin(const string& stream_url);
+    bool isPinned(const string& stream_url);
+    vector<string> getPinnedStreams();
+
+   private:
+    HlmIngestManager() = default;
+    HlmIngestManager(const HlmIngestManager&) = delete;
+    HlmIngestManager& operator=(const HlmIngestManager&) = delete;
+
+    // 常驻流通过一个不消费数据的订阅者保持会话
+    struct HlmIngestPin {
+        shared_ptr<HlmIngestSession> session;
+        shared_ptr<HlmIngestSubscriber> subscriber;
+    };
+
+    mutex mutex_;
+    unordered_map<string, shared_ptr<HlmIngestSession>> sessions_;
+    mutex pin_mutex_;
+    unordered_map<string, HlmIngestPin> pins_;
+};
+
+#endif  // HLM_INGEST_H
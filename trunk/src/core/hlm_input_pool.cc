@@ -0,0 +1,177 @@
+#include "hlm_input_pool.h"
+
+#include "hlm_screenshot_cache.h"
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+#include "utils/hlm_time.h"
+
+HlmInputPool& HlmInputPool::getInstance() {
+    static HlmInputPool instance;
+    return instance;
+}
+
+HlmInputPool::HlmInputPool()
+    : enabled_(CONF.isInputPoolEnabled()),
+      idle_ttl_us_(CONF.getInputPoolIdleTtlUs()),
+      max_idle_(max(0, CONF.getInputPoolMaxIdle())) {
+    if (enabled_) {
+        reap_thread_ = make_unique<HlmThread>("input pool", [this]() { reapLoop(); });
+        reap_thread_->start();
+    }
+}
+
+HlmInputPool::~HlmInputPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_var_.notify_all();
+    if (reap_thread_) {
+        reap_thread_->stop();
+    }
+
+    for (auto& idle : idle_inputs_) {
+        for (auto& input : idle.second) {
+            closeInput(input);
+        }
+    }
+}
+
+string HlmInputPool::poolKey(const string& url, bool keyframes_only, int thread_type) {
+    if (!CONF.isInputPoolEnabled()) {
+        return "";
+    }
+    string file_key = HlmScreenshotCache::fileKey(url);
+    if (file_key.empty()) {
+        return "";
+    }
+    // 只解码关键帧或多线程方式不同的解码器打开参数不同，分开入池；线程数随负载变化，不区分
+    return file_key + (keyframes_only ? "|keyframes" : "") + (thread_type == FF_THREAD_SLICE ? "|slice" : "");
+}
+
+bool HlmInputPool::checkout(const string& key, HlmPooledInput& input) {
+    lock_guard<mutex> lock(mutex_);
+    auto it = idle_inputs_.find(key);
+    if (it == idle_inputs_.end() || it->second.empty()) {
+        stats_.misses++;
+        return false;
+    }
+
+    // 优先取最近归还的输入，文件数据更可能还在页缓存中
+    input = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty()) {
+        idle_inputs_.erase(it);
+    }
+    idle_count_--;
+    stats_.hits++;
+    return true;
+}
+
+void HlmInputPool::checkin(const string& key, HlmPooledInput input) {
+    if (!enabled_ || max_idle_ == 0 || !resetInput(input)) {
+        closeInput(input);
+        return;
+    }
+
+    vector<HlmPooledInput> expired;
+    {
+        lock_guard<mutex> lock(mutex_);
+        input.idle_since = getCurrentTimeInMicroseconds();
+        idle_inputs_[key].push_back(input);
+        idle_count_++;
+
+        // 超过上限时关闭最早空闲的输入
+        while (idle_count_ > max_idle_) {
+            auto oldest = idle_inputs_.end();
+            for (auto it = idle_inputs_.begin(); it != idle_inputs_.end(); ++it) {
+                if (oldest == idle_inputs_.end() || it->second.front().idle_since < oldest->second.front().idle_since) {
+                    oldest = it;
+                }
+            }
+            expired.push_back(oldest->second.front());
+            oldest->second.erase(oldest->second.begin());
+            if (oldest->second.empty()) {
+                idle_inputs_.erase(oldest);
+            }
+            idle_count_--;
+            stats_.expired++;
+        }
+    }
+
+    for (auto& input : expired) {
+        closeInput(input);
+    }
+}
+
+HlmInputPoolStats HlmInputPool::getStats() const {
+    lock_guard<mutex> lock(mutex_);
+    HlmInputPoolStats stats = stats_;
+    stats.idle = idle_count_;
+    return stats;
+}
+
+void HlmInputPool::reapLoop() {
+    unique_lock<mutex> lock(mutex_);
+    while (running_) {
+        cond_var_.wait_for(lock, chrono::milliseconds(REAP_INTERVAL_MS));
+        vector<HlmPooledInput> expired;
+        collectExpired(getCurrentTimeInMicroseconds(), expired);
+        if (expired.empty()) {
+            continue;
+        }
+
+        // 关闭输入可能较慢，不持有锁
+        lock.unlock();
+        for (auto& input : expired) {
+            closeInput(input);
+        }
+        hlm_info("Closed {} idle inputs after {}s.", expired.size(), idle_ttl_us_ / 1000000);
+        lock.lock();
+    }
+}
+
+void HlmInputPool::collectExpired(int64_t now, vector<HlmPooledInput>& expired) {
+    for (auto it = idle_inputs_.begin(); it != idle_inputs_.end();) {
+        auto& inputs = it->second;
+        for (auto input = inputs.begin(); input != inputs.end();) {
+            if (now - input->idle_since >= idle_ttl_us_) {
+                expired.push_back(*input);
+                input = inputs.erase(input);
+                idle_count_--;
+                stats_.expired++;
+            } else {
+                ++input;
+            }
+        }
+        it = inputs.empty() ? idle_inputs_.erase(it) : next(it);
+    }
+}
+
+bool HlmInputPool::resetInput(HlmPooledInput& input) {
+    if (!input.format_context || !input.video_decoder) {
+        return false;
+    }
+
+    // 归还后不再回调原任务；恢复到文件开头，清除上一个任务设置的流丢弃标记和解码器状态
+    AVFormatContext* format_context = input.format_context;
+    format_context->interrupt_callback = {nullptr, nullptr};
+    for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+        format_context->streams[i]->discard = AVDISCARD_DEFAULT;
+    }
+    int64_t start_time = format_context->start_time != AV_NOPTS_VALUE ? format_context->start_time : 0;
+    if (av_seek_frame(format_context, -1, start_time, AVSEEK_FLAG_BACKWARD) < 0) {
+        hlm_warn("Failed to rewind input {}, not reusing it.", format_context->url ? format_context->url : "");
+        return false;
+    }
+    avcodec_flush_buffers(input.video_decoder->getCodecContext());
+    return true;
+}
+
+void HlmInputPool::closeInput(HlmPooledInput& input) {
+    delete input.video_decoder;
+    input.video_decoder = nullptr;
+    if (input.format_context) {
+        avformat_close_input(&input.format_context);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef HLM_INPUT_POOL_H
+#define HLM_INPUT_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hlm_decoder.h"
+#include "utils/hlm_thread.h"
+
+using namespace std;
+
+// 已打开、已探测的输入及其视频解码器
+struct HlmPooledInput {
+    AVFormatContext* format_context = nullptr;
+    HlmDecoder* video_decoder = nullptr;
+    int64_t idle_since = 0;
+};
+
+struct HlmInputPoolStats {
+    uint64_t hits = 0;      // 复用空闲输入的次数
+    uint64_t misses = 0;    // 没有空闲输入需要重新打开的次数
+    uint64_t expired = 0;   // 空闲超时或超过上限被关闭的输入数
+    size_t idle = 0;        // 当前空闲输入数
+};
+
+// 文件输入池：任务结束后把输入和解码器归还到池中，同一文件的下一个任务取出后 seek 即可解码，
+// 省去 avformat_open_input、avformat_find_stream_info 和 avcodec_open2
+class HlmInputPool {
+   public:
+    static HlmInputPool& getInstance();
+    ~HlmInputPool();
+
+    // 本地文件按路径、修改时间和大小生成 key，文件被修改后不会复用旧的输入；不能入池时返回空
+    static string poolKey(const string& url, bool keyframes_only, int thread_type);
+
+    bool checkout(const string& key, HlmPooledInput& input);
+    void checkin(const string& key, HlmPooledInput input);
+    HlmInputPoolStats getStats() const;
+
+   private:
+    HlmInputPool();
+    HlmInputPool(const HlmInputPool&) = delete;
+    HlmInputPool& operator=(const HlmInputPool&) = delete;
+
+    void reapLoop();
+    void collectExpired(int64_t now, vector<HlmPooledInput>& expired);
+    static bool resetInput(HlmPooledInput& input);
+    static void closeInput(HlmPooledInput& input);
+
+    bool enabled_;
+    int64_t idle_ttl_us_;
+    size_t max_idle_;
+
+    mutable mutex mutex_;
+    condition_variable cond_var_;
+    bool running_ = true;
+    unordered_map<string, vector<HlmPooledInput>> idle_inputs_;
+    size_t idle_count_ = 0;
+    HlmInputPoolStats stats_;
+    unique_ptr<HlmThread> reap_thread_;
+
+    static const int64_t REAP_INTERVAL_MS = 1000;  // 检查空闲超时的间隔
+};
+
+#endif  // HLM_INPUT_POOL_H
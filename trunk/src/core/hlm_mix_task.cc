@@ -4,7 +4,10 @@
 #include "utils/hlm_logger.h"
 
 HlmMixTask::HlmMixTask(const HlmMixTaskParams& params)
-    : HlmTask(TaskType::Mixing, params.output_url, HlmMixMethod::Mix), params_(params) {}
+    : HlmTask(TaskType::Mixing, params.output_url, HlmMixMethod::Mix), params_(params) {
+    media_profile_.width = params.resolution.width;
+    media_profile_.height = params.resolution.height;
+}
 
 void HlmMixTask::execute() {
     if (!executor_) {
@@ -25,6 +28,15 @@ void HlmMixTask::stop() {
     }
 }
 
+HlmTaskCost HlmMixTask::estimateCost() const {
+    // 输出编码一路，每路输入流按默认媒体信息实时解码
+    HlmTaskCost cost = HlmTaskCostModel::encodeCost(media_profile_);
+    for (size_t i = 0; i < params_.streams.size(); i++) {
+        cost = HlmTaskCostModel::sum(cost, HlmTaskCostModel::decodeCost(HlmMediaProfile(), 1.0));
+    }
+    return cost;
+}
+
 HlmDefaultMixTask::HlmDefaultMixTask(const HlmMixTaskParams& params)
     : HlmMixTask(params) {}
 
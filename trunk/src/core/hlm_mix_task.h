@@ -15,6 +15,7 @@ class HlmMixTask : public HlmTask {
     void execute() override;
     void update(const HlmMixTaskParams& params);
     void stop() override;
+    HlmTaskCost estimateCost() const override;
 
    protected:
     virtual unique_ptr<HlmMixExecutor> createExecutor() = 0;
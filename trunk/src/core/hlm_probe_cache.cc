@@ -0,0 +1,159 @@
+#include "hlm_probe_cache.h"
+
+#include <algorithm>
+
+#include "hlm_screenshot_cache.h"
+#include "utils/hlm_logger.h"
+#include "utils/hlm_time.h"
+
+HlmProbeCache& HlmProbeCache::getInstance() {
+    static HlmProbeCache instance;
+    return instance;
+}
+
+HlmProbeCache::HlmProbeCache()
+    : enabled_(CONF.isProbeCacheEnabled()),
+      max_entries_(max(0, CONF.getProbeCacheMaxEntries())) {}
+
+bool HlmProbeCache::probe(AVFormatContext* format_context, const string& url, const ProbeSettings& settings) {
+    int64_t start_time = getCurrentTimeInMicroseconds();
+    string key = cacheKey(url);
+
+    shared_ptr<const Entry> entry;
+    if (enabled_ && max_entries_ > 0) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            entry = it->second;
+        }
+    }
+
+    if (entry) {
+        const ProbeSettings& cached = CONF.getCachedProbe();
+        format_context->probesize = cached.probesize;
+        format_context->max_analyze_duration = cached.analyzeduration_ms * 1000;
+        if (avformat_find_stream_info(format_context, nullptr) >= 0 && applyEntry(format_context, *entry)) {
+            int64_t elapsed_us = getCurrentTimeInMicroseconds() - start_time;
+            recordProbe(true, elapsed_us);
+            hlm_info("Probed {} with cached stream info in {}ms", url, elapsed_us / 1000);
+            return true;
+        }
+
+        // 流的编码参数或布局已变化，丢弃缓存后按完整参数继续探测，已读取的数据不会丢失
+        hlm_warn("Cached stream info no longer matches {}, probing again.", url);
+        lock_guard<mutex> lock(mutex_);
+        entries_.erase(key);
+        stats_.stale++;
+    }
+
+    format_context->probesize = settings.probesize;
+    format_context->max_analyze_duration = settings.analyzeduration_ms * 1000;
+    if (avformat_find_stream_info(format_context, nullptr) < 0) {
+        return false;
+    }
+
+    int64_t elapsed_us = getCurrentTimeInMicroseconds() - start_time;
+    recordProbe(false, elapsed_us);
+    hlm_info("Probed {} in {}ms", url, elapsed_us / 1000);
+    if (enabled_ && max_entries_ > 0) {
+        store(key, format_context);
+    }
+    return true;
+}
+
+HlmProbeStats HlmProbeCache::getStats() const {
+    lock_guard<mutex> lock(mutex_);
+    HlmProbeStats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+string HlmProbeCache::cacheKey(const string& url) {
+    // 本地文件带上修改时间和大小，文件被替换后不会用到旧的流信息
+    string file_key = HlmScreenshotCache::fileKey(url);
+    return file_key.empty() ? url : file_key;
+}
+
+bool HlmProbeCache::isComplete(const AVCodecParameters* codecpar) {
+    if (codecpar->codec_id == AV_CODEC_ID_NONE) {
+        return false;
+    }
+    if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        return codecpar->width > 0 && codecpar->height > 0 && codecpar->format >= 0;
+    }
+    if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+        return codecpar->sample_rate > 0 && codecpar->channels > 0;
+    }
+    return true;
+}
+
+bool HlmProbeCache::applyEntry(AVFormatContext* format_context, const Entry& entry) {
+    if (format_context->nb_streams != entry.streams.size()) {
+        return false;
+    }
+
+    // 先确认流布局一致再补齐参数，不一致时保持探测结果不变
+    for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+        const AVCodecParameters* codecpar = format_context->streams[i]->codecpar;
+        const AVCodecParameters* cached = entry.streams[i].get();
+        if (codecpar->codec_type != cached->codec_type) {
+            return false;
+        }
+        if (codecpar->codec_id != AV_CODEC_ID_NONE && codecpar->codec_id != cached->codec_id) {
+            return false;
+        }
+    }
+
+    for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+        AVCodecParameters* codecpar = format_context->streams[i]->codecpar;
+        const AVCodecParameters* cached = entry.streams[i].get();
+        // 最小探测没有得到完整参数的流（如还没等到关键帧）使用上一次探测的结果
+        if (!isComplete(codecpar) || (!codecpar->extradata && cached->extradata)) {
+            if (avcodec_parameters_copy(codecpar, cached) < 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void HlmProbeCache::store(const string& key, AVFormatContext* format_context) {
+    auto entry = make_shared<Entry>();
+    for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+        const AVCodecParameters* codecpar = format_context->streams[i]->codecpar;
+        if (!isComplete(codecpar)) {
+            // 参数不完整的探测结果不能用来补齐下一次的探测
+            return;
+        }
+        shared_ptr<AVCodecParameters> copy(avcodec_parameters_alloc(), [](AVCodecParameters* par) { avcodec_parameters_free(&par); });
+        if (!copy || avcodec_parameters_copy(copy.get(), codecpar) < 0) {
+            return;
+        }
+        entry->streams.push_back(copy);
+    }
+    entry->stored_at = getCurrentTimeInMicroseconds();
+
+    lock_guard<mutex> lock(mutex_);
+    entries_[key] = entry;
+    // 超过上限时淘汰最早保存的 URL
+    while (entries_.size() > max_entries_) {
+        auto oldest = entries_.begin();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->second->stored_at < oldest->second->stored_at) {
+                oldest = it;
+            }
+        }
+        entries_.erase(oldest);
+    }
+}
+
+void HlmProbeCache::recordProbe(bool hit, int64_t elapsed_us) {
+    lock_guard<mutex> lock(mutex_);
+    if (hit) {
+        stats_.hits++;
+        stats_.hit_probe_us += elapsed_us;
+    } else {
+        stats_.misses++;
+        stats_.full_probe_us += elapsed_us;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef HLM_PROBE_CACHE_H
+#define HLM_PROBE_CACHE_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/hlm_config.h"
+
+using namespace std;
+
+struct HlmProbeStats {
+    uint64_t hits = 0;            // 命中缓存、最小探测即可开始的次数
+    uint64_t misses = 0;          // 未命中缓存做完整探测的次数
+    uint64_t stale = 0;           // 缓存与实际流不一致，重新完整探测的次数
+    int64_t hit_probe_us = 0;     // 命中时探测的累计耗时
+    int64_t full_probe_us = 0;    // 完整探测的累计耗时
+    size_t entries = 0;
+};
+
+// 流信息探测缓存：按 URL 保存上一次成功探测的各流编码参数，下一次打开同一 URL 时
+// 只用很小的 probesize/analyzeduration 探测，缺失的参数从缓存补齐，省去实时流开始前的大部分等待
+class HlmProbeCache {
+   public:
+    static HlmProbeCache& getInstance();
+
+    // 代替 avformat_find_stream_info，settings 为未命中缓存时的探测参数
+    bool probe(AVFormatContext* format_context, const string& url, const ProbeSettings& settings);
+
+    HlmProbeStats getStats() const;
+
+   private:
+    HlmProbeCache();
+    HlmProbeCache(const HlmProbeCache&) = delete;
+    HlmProbeCache& operator=(const HlmProbeCache&) = delete;
+
+    struct Entry {
+        vector<shared_ptr<AVCodecParameters>> streams;
+        int64_t stored_at = 0;
+    };
+
+    static string cacheKey(const string& url);
+    static bool isComplete(const AVCodecParameters* codecpar);
+    static bool applyEntry(AVFormatContext* format_context, const Entry& entry);
+    void store(const string& key, AVFormatContext* format_context);
+    void recordProbe(bool hit, int64_t elapsed_us);
+
+    bool enabled_;
+    size_t max_entries_;
+
+    mutable mutex mutex_;
+    unordered_map<string, shared_ptr<const Entry>> entries_;
+    HlmProbeStats stats_;
+};
+
+#endif  // HLM_PROBE_CACHE_H
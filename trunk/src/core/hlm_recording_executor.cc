@@ -76,14 +76,21 @@ bool HlmRecordingExecutor::initOutputFile() {
              (int)output_audio_stream->codecpar->codec_type, output_audio_stream->codecpar->bit_rate,
              output_audio_stream->codecpar->sample_rate, output_audio_stream->codecpar->channels);
 
+    // 录制数据通过自定义 AVIOContext 交给异步写入服务，拉流线程不等待磁盘
+    HlmFileWriter::getInstance().bindFormatContext(output_format_context_, write_backlog_);
     if (!(output_format_context_->oformat->flags & AVFMT_NOFILE)) {
-        if (avio_open(&output_format_context_->pb, filename_.c_str(), AVIO_FLAG_WRITE) < 0) {
+        output_format_context_->pb = HlmFileWriter::getInstance().openAvio(filename_, write_backlog_);
+        if (!output_format_context_->pb) {
             hlm_error("Failed to open output file: {}", filename_);
             return false;
         }
     }
 
-    if (avformat_write_header(output_format_context_, nullptr) < 0) {
+    AVDictionary* options = nullptr;
+    setMuxerOptions(&options);
+    int ret = avformat_write_header(output_format_context_, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
         hlm_error("Failed to write header to output file.");
         return false;
     }
@@ -100,20 +107,29 @@ void HlmRecordingExecutor::execute() {
     }
 
     AVPacket* packet = av_packet_alloc();
-    while (isRunning() && av_read_frame(input_format_context_, packet) >= 0) {
+    while (isRunning()) {
+        if (!readPacket(packet)) {
+            // 实时流断流时重连并继续写当前文件，不必重新创建录制任务
+            if (isRunning() && stream_url_.find("rtmp://") == 0 && reconnect()) {
+                continue;
+            }
+            break;
+        }
         updateStartTime();
         int64_t pts = packet->pts;
         double frame_time = pts * av_q2d(input_format_context_->streams[packet->stream_index]->time_base);
         hlm_debug("Processing {} recording. PTS: {}, time: {}s, stream index:{}", media_method_, pts, frame_time, packet->stream_index);
 
         if (packet->stream_index == input_video_stream_index_) {
-            packet->stream_index = output_video_stream_index_;
-            checkAndSavePacket(packet, output_video_stream_index_);
-        }
-
-        if (packet->stream_index == input_audio_stream_index_) {
-            packet->stream_index = output_audio_stream_index_;
-            checkAndSavePacket(packet, output_audio_stream_index_);
+            if (rebaseTimestamps(packet, output_video_stream_index_)) {
+                packet->stream_index = output_video_stream_index_;
+                checkAndSavePacket(packet, output_video_stream_index_);
+            }
+        } else if (packet->stream_index == input_audio_stream_index_) {
+            if (rebaseTimestamps(packet, output_audio_stream_index_)) {
+                packet->stream_index = output_audio_stream_index_;
+                checkAndSavePacket(packet, output_audio_stream_index_);
+            }
         }
         av_packet_unref(packet);
     }
@@ -121,6 +137,81 @@ void HlmRecordingExecutor::execute() {
     endRecording();
 }
 
+bool HlmRecordingExecutor::reconnect() {
+    if (!reconnectInput()) {
+        hlm_error("Failed to reconnect to stream: {}, ending recording.", stream_url_);
+        return false;
+    }
+    if (!streamsCompatible()) {
+        hlm_error("Stream parameters changed after reconnecting to: {}, ending recording.", stream_url_);
+        return false;
+    }
+    rebase_pending_ = true;
+    wait_keyframe_ = true;
+    return true;
+}
+
+bool HlmRecordingExecutor::streamsCompatible() const {
+    // 输出文件的编码参数在写头时已确定，重连后编码格式、分辨率或采样率变化时无法继续写入
+    if (input_video_stream_index_ == -1 || input_audio_stream_index_ == -1) {
+        return false;
+    }
+    const AVCodecParameters* video_in = input_format_context_->streams[input_video_stream_index_]->codecpar;
+    const AVCodecParameters* video_out = output_format_context_->streams[output_video_stream_index_]->codecpar;
+    const AVCodecParameters* audio_in = input_format_context_->streams[input_audio_stream_index_]->codecpar;
+    const AVCodecParameters* audio_out = output_format_context_->streams[output_audio_stream_index_]->codecpar;
+    return video_in->codec_id == video_out->codec_id && video_in->width == video_out->width && video_in->height == video_out->height &&
+           audio_in->codec_id == audio_out->codec_id && audio_in->sample_rate == audio_out->sample_rate;
+}
+
+bool HlmRecordingExecutor::rebaseTimestamps(AVPacket* packet, int output_stream_index) {
+    bool is_video = output_stream_index == output_video_stream_index_;
+    if (wait_keyframe_) {
+        if (!is_video || !(packet->flags & AV_PKT_FLAG_KEY)) {
+            return false;
+        }
+        wait_keyframe_ = false;
+    }
+
+    AVRational time_base = input_format_context_->streams[packet->stream_index]->time_base;
+    int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    if (dts == AV_NOPTS_VALUE) {
+        return true;
+    }
+    if (rebase_pending_ && last_end_us_ != AV_NOPTS_VALUE) {
+        // 新连接的时间戳可能从 0 或任意值开始，第一个包接在上一段结束之后，音视频使用同一偏移保持同步
+        ts_offset_us_ = last_end_us_ - av_rescale_q(dts, time_base, AV_TIME_BASE_Q);
+        hlm_info("Rebased timestamps of {} by {}ms after reconnecting.", stream_url_, ts_offset_us_ / 1000);
+    }
+    rebase_pending_ = false;
+
+    int64_t offset = av_rescale_q(ts_offset_us_, AV_TIME_BASE_Q, time_base);
+    dts += offset;
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts += offset;
+    }
+
+    // 同一路输出的 dts 必须严格递增，回退的包顺延到上一个包之后
+    int64_t& last_dts_us = last_dts_us_[is_video ? 0 : 1];
+    if (last_dts_us != AV_NOPTS_VALUE) {
+        int64_t min_dts = av_rescale_q_rnd(last_dts_us, AV_TIME_BASE_Q, time_base, static_cast<AVRounding>(AV_ROUND_DOWN)) + 1;
+        if (dts < min_dts) {
+            if (packet->pts != AV_NOPTS_VALUE) {
+                packet->pts += min_dts - dts;
+            }
+            dts = min_dts;
+        }
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts = dts;
+    }
+
+    last_dts_us = av_rescale_q(dts, time_base, AV_TIME_BASE_Q);
+    int64_t end_us = av_rescale_q(dts + max<int64_t>(packet->duration, 1), time_base, AV_TIME_BASE_Q);
+    last_end_us_ = last_end_us_ == AV_NOPTS_VALUE ? end_us : max(last_end_us_, end_us);
+    return true;
+}
+
 void HlmRecordingExecutor::setHlsSegmentFilename() {
     size_t pos = filename_.find_last_of('.');
     if (pos != string::npos) {
@@ -136,7 +227,7 @@ void HlmRecordingExecutor::endRecording() {
     }
 
     if (!(output_format_context_->oformat->flags & AVFMT_NOFILE)) {
-        avio_closep(&output_format_context_->pb);
+        HlmFileWriter::getInstance().closeAvio(&output_format_context_->pb, true);
     }
     hlm_info("Recording {} end and output file closed for stream: {}", media_method_, stream_url_);
 }
@@ -168,6 +259,18 @@ void HlmMp4RecordingExecutor::checkAndSavePacket(AVPacket* encoded_packet, int s
     }
 }
 
+HlmFmp4RecordingExecutor::HlmFmp4RecordingExecutor(const string& stream_url, const string& output_dir, const string& filename, const string& recording_method)
+    : HlmMp4RecordingExecutor(stream_url, output_dir, filename, recording_method) {
+}
+
+void HlmFmp4RecordingExecutor::setMuxerOptions(AVDictionary** options) {
+    // 每个关键帧或达到分片时长时输出一个分片，复用器只缓存当前分片；结束时只需写入很小的 mfra
+    av_dict_set(options, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    av_dict_set_int(options, "frag_duration", CONF.getFmp4FragmentUs(), 0);
+    // 分片写出后立即交给写入服务，不在 AVIOContext 缓冲区中停留
+    output_format_context_->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+}
+
 HlmHlsRecordingExecutor::HlmHlsRecordingExecutor(const string& stream_url, const string& output_dir, const string& filename, const string& recording_method)
     : HlmRecordingExecutor(stream_url, output_dir, filename, recording_method) {
 }
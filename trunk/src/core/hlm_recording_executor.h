@@ -23,11 +23,24 @@ class HlmRecordingExecutor : public HlmExecutor {
     void execute() override;
 
    protected:
+    const ProbeSettings& probeSettings() const override { return CONF.getRecordingProbe(); }
+    // 写文件头前设置复用器参数
+    virtual void setMuxerOptions(AVDictionary** options) {}
     void setHlsSegmentFilename();
     void endRecording();
+    bool reconnect();
+    bool streamsCompatible() const;
+    bool rebaseTimestamps(AVPacket* packet, int output_stream_index);
 
    protected:
     string recording_method_;
+
+    // 断流重连后继续写同一个输出文件：新连接的时间戳整体平移到上一段之后，并保证每路 dts 单调递增
+    int64_t ts_offset_us_ = 0;
+    int64_t last_end_us_ = AV_NOPTS_VALUE;  // 已写入数据的最大结束时间
+    int64_t last_dts_us_[2] = {AV_NOPTS_VALUE, AV_NOPTS_VALUE};  // 视频、音频输出流上一个包的 dts
+    bool rebase_pending_ = false;
+    bool wait_keyframe_ = false;  // 重连后从视频关键帧开始写入
 };
 
 // 录制为MP4格式
@@ -37,6 +50,15 @@ class HlmMp4RecordingExecutor : public HlmRecordingExecutor {
     void checkAndSavePacket(AVPacket* encoded_packet, int stream_index) override;
 };
 
+// 录制为分片MP4格式：moov 在文件开头且不含样本索引，每个分片写完即落盘
+class HlmFmp4RecordingExecutor : public HlmMp4RecordingExecutor {
+   public:
+    HlmFmp4RecordingExecutor(const string& stream_url, const string& output_dir, const string& filename, const string& recording_method);
+
+   protected:
+    void setMuxerOptions(AVDictionary** options) override;
+};
+
 // 录制为HLS格式
 class HlmHlsRecordingExecutor : public HlmRecordingExecutor {
    public:
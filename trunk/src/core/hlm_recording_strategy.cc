@@ -5,6 +5,10 @@ shared_ptr<HlmTask> HlmMp4RecordingStrategy::createTask(const string& stream_url
     return make_shared<HlmMp4RecordingTask>(stream_url, method, output_dir, filename);
 }
 
+shared_ptr<HlmTask> HlmFmp4RecordingStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename, const json::rvalue& body) {
+    return make_shared<HlmFmp4RecordingTask>(stream_url, method, output_dir, filename);
+}
+
 shared_ptr<HlmTask> HlmHlsRecordingStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename, const json::rvalue& body) {
     return make_shared<HlmHlsRecordingTask>(stream_url, method, output_dir, filename);
 }
@@ -12,6 +16,8 @@ shared_ptr<HlmTask> HlmHlsRecordingStrategy::createTask(const string& stream_url
 shared_ptr<HlmRecordingStrategy> HlmRecordingStrategyFactory::createStrategy(const string& method) {
     if (method == HlmRecordingMethod::Mp4) {
         return make_shared<HlmMp4RecordingStrategy>();
+    } else if (method == HlmRecordingMethod::Fmp4) {
+        return make_shared<HlmFmp4RecordingStrategy>();
     } else if (method == HlmRecordingMethod::Hls) {
         return make_shared<HlmHlsRecordingStrategy>();
     } else {
@@ -24,6 +24,12 @@ class HlmMp4RecordingStrategy : public HlmRecordingStrategy {
     shared_ptr<HlmTask> createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename, const json::rvalue& body) override;
 };
 
+// 录制分片MP4策略
+class HlmFmp4RecordingStrategy : public HlmRecordingStrategy {
+   public:
+    shared_ptr<HlmTask> createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename, const json::rvalue& body) override;
+};
+
 // 录制HLS策略
 class HlmHlsRecordingStrategy : public HlmRecordingStrategy {
    public:
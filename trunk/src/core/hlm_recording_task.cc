@@ -19,6 +19,11 @@ void HlmRecordingTask::stop() {
     }
 }
 
+HlmTaskCost HlmRecordingTask::estimateCost() const {
+    // 录制直接转封装，不解码不编码
+    return HlmTaskCostModel::streamCopyCost();
+}
+
 // MP4 录制任务实现
 HlmMp4RecordingTask::HlmMp4RecordingTask(const string& stream_url, const string& method, const string& output_dir, const string& filename)
     : HlmRecordingTask(stream_url, method), output_dir_(output_dir), filename_(filename) {}
@@ -27,6 +32,14 @@ unique_ptr<HlmRecordingExecutor> HlmMp4RecordingTask::createExecutor() {
     return make_unique<HlmMp4RecordingExecutor>(getStreamUrl(), output_dir_, filename_, HlmRecordingMethod::Mp4);
 }
 
+// 分片 MP4 录制任务实现
+HlmFmp4RecordingTask::HlmFmp4RecordingTask(const string& stream_url, const string& method, const string& output_dir, const string& filename)
+    : HlmRecordingTask(stream_url, method), output_dir_(output_dir), filename_(filename) {}
+
+unique_ptr<HlmRecordingExecutor> HlmFmp4RecordingTask::createExecutor() {
+    return make_unique<HlmFmp4RecordingExecutor>(getStreamUrl(), output_dir_, filename_, HlmRecordingMethod::Fmp4);
+}
+
 // HLS 录制任务实现
 HlmHlsRecordingTask::HlmHlsRecordingTask(const string& stream_url, const string& method, const string& output_dir, const string& filename)
     : HlmRecordingTask(stream_url, method), output_dir_(output_dir), filename_(filename){}
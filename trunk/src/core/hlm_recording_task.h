@@ -14,6 +14,7 @@ class HlmRecordingTask : public HlmTask {
 
     void execute() override;
     void stop() override;
+    HlmTaskCost estimateCost() const override;
 
    protected:
     virtual unique_ptr<HlmRecordingExecutor> createExecutor() = 0;
@@ -34,6 +35,19 @@ class HlmMp4RecordingTask : public HlmRecordingTask {
     string filename_;
 };
 
+// 分片 MP4 录制任务
+class HlmFmp4RecordingTask : public HlmRecordingTask {
+   public:
+    HlmFmp4RecordingTask(const string& stream_url, const string& method, const string& output_dir, const string& filename);
+
+   protected:
+    unique_ptr<HlmRecordingExecutor> createExecutor() override;
+
+   private:
+    string output_dir_;
+    string filename_;
+};
+
 // HLS 录制任务
 class HlmHlsRecordingTask : public HlmRecordingTask {
    public:
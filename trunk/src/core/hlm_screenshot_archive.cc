@@ -0,0 +1,267 @@
+#include "hlm_screenshot_archive.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+#include "utils/hlm_time.h"
+
+HlmScreenshotArchive::HlmScreenshotArchive(const string& output_dir, const string& filename_prefix, shared_ptr<HlmWriteBacklog> backlog)
+    : output_dir_(output_dir),
+      filename_prefix_(filename_prefix),
+      backlog_(move(backlog)),
+      max_pack_bytes_(CONF.getArchiveMaxPackBytes()),
+      max_pack_us_(CONF.getArchiveMaxPackSeconds() * 1000000) {
+    // 同一前缀已有归档时从下一个序号开始，不覆盖之前任务的归档
+    vector<int> sequences = listSequences(output_dir_, filename_prefix_);
+    sequence_ = sequences.empty() ? -1 : sequences.back();
+}
+
+HlmScreenshotArchive::~HlmScreenshotArchive() {
+    close();
+}
+
+string HlmScreenshotArchive::packFilename(const string& filename_prefix, int sequence) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%06d.pack", sequence);
+    return filename_prefix + suffix;
+}
+
+string HlmScreenshotArchive::indexFilename(const string& filename_prefix, int sequence) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%06d.idx", sequence);
+    return filename_prefix + suffix;
+}
+
+vector<int> HlmScreenshotArchive::listSequences(const string& output_dir, const string& filename_prefix) {
+    vector<int> sequences;
+    error_code ec;
+    for (const auto& dir_entry : filesystem::directory_iterator(output_dir, ec)) {
+        string name = dir_entry.path().filename().string();
+        // 文件名格式：<prefix>_<6位序号>.idx
+        if (name.size() != filename_prefix.size() + 11 || name.compare(0, filename_prefix.size(), filename_prefix) != 0 ||
+            name[filename_prefix.size()] != '_' || name.compare(name.size() - 4, 4, ".idx") != 0) {
+            continue;
+        }
+        string digits = name.substr(filename_prefix.size() + 1, 6);
+        if (all_of(digits.begin(), digits.end(), ::isdigit)) {
+            sequences.push_back(stoi(digits));
+        }
+    }
+    sort(sequences.begin(), sequences.end());
+    return sequences;
+}
+
+void HlmScreenshotArchive::open() {
+    sequence_++;
+    pack_file_ = HlmFileWriter::getInstance().openFile(output_dir_ + "/" + packFilename(filename_prefix_, sequence_), backlog_);
+    index_file_ = HlmFileWriter::getInstance().openFile(output_dir_ + "/" + indexFilename(filename_prefix_, sequence_), backlog_);
+    pack_size_ = 0;
+    index_size_ = 0;
+    opened_at_ = getCurrentTimeInMicroseconds();
+    hlm_info("Opened screenshot archive: {}/{}", output_dir_, packFilename(filename_prefix_, sequence_));
+}
+
+void HlmScreenshotArchive::close() {
+    if (!pack_file_) {
+        return;
+    }
+    HlmFileWriter::getInstance().close(pack_file_, false);
+    HlmFileWriter::getInstance().close(index_file_, false);
+    pack_file_.reset();
+    index_file_.reset();
+}
+
+bool HlmScreenshotArchive::needsRotation(size_t size) const {
+    if (pack_size_ == 0) {
+        return false;
+    }
+    return pack_size_ + static_cast<int64_t>(size) > max_pack_bytes_ || getCurrentTimeInMicroseconds() - opened_at_ >= max_pack_us_;
+}
+
+bool HlmScreenshotArchive::append(AVBufferRef* buffer, const uint8_t* data, size_t size, int index, int width, double frame_time) {
+    if (pack_file_ && needsRotation(size)) {
+        close();
+    }
+    if (!pack_file_) {
+        open();
+    }
+
+    // 图片写入被丢弃时不推进偏移，也不写索引
+    if (!HlmFileWriter::getInstance().write(pack_file_, pack_size_, buffer, data, size, HlmWritePolicy::Drop)) {
+        return false;
+    }
+
+    AVBufferRef* entry_buffer = av_buffer_allocz(sizeof(HlmArchiveIndexEntry));
+    if (!entry_buffer) {
+        hlm_error("Failed to allocate archive index entry for image {}.", index);
+        return false;
+    }
+    HlmArchiveIndexEntry* entry = reinterpret_cast<HlmArchiveIndexEntry*>(entry_buffer->data);
+    entry->offset = pack_size_;
+    entry->size = static_cast<uint32_t>(size);
+    entry->index = static_cast<uint32_t>(index);
+    entry->timestamp_ms = llround(frame_time * 1000);
+    entry->width = static_cast<uint32_t>(width);
+    pack_size_ += size;
+
+    // 索引必须与打包文件一致，积压已满时等待而不是丢弃
+    HlmFileWriter::getInstance().write(index_file_, index_size_, entry_buffer, entry_buffer->data, sizeof(HlmArchiveIndexEntry), HlmWritePolicy::Block);
+    index_size_ += sizeof(HlmArchiveIndexEntry);
+    return true;
+}
+
+HlmScreenshotArchiveReader::HlmScreenshotArchiveReader(const string& output_dir, const string& filename_prefix)
+    : output_dir_(output_dir), filename_prefix_(filename_prefix) {
+    for (int sequence : HlmScreenshotArchive::listSequences(output_dir_, filename_prefix_)) {
+        string path = output_dir_ + "/" + HlmScreenshotArchive::indexFilename(filename_prefix_, sequence);
+        error_code ec;
+        uintmax_t file_size = filesystem::file_size(path, ec);
+        size_t entries = ec ? 0 : file_size / sizeof(HlmArchiveIndexEntry);
+        if (entries > 0) {
+            index_files_.push_back({sequence, path, entries});
+        }
+    }
+}
+
+bool HlmScreenshotArchiveReader::readByIndex(int index, int width, string& image) const {
+    HlmArchiveIndexEntry entry;
+    int sequence = 0;
+    return findEntry(true, index, width, entry, sequence) && readImage(sequence, entry, image);
+}
+
+bool HlmScreenshotArchiveReader::readByTimestamp(double timestamp, int width, string& image) const {
+    HlmArchiveIndexEntry entry;
+    int sequence = 0;
+    return findEntry(false, llround(timestamp * 1000), width, entry, sequence) && readImage(sequence, entry, image);
+}
+
+bool HlmScreenshotArchiveReader::readEntry(const IndexFile& index_file, size_t position, HlmArchiveIndexEntry& entry) const {
+    int fd = ::open(index_file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t read_bytes = pread(fd, &entry, sizeof(entry), position * sizeof(entry));
+    ::close(fd);
+    return read_bytes == sizeof(entry);
+}
+
+bool HlmScreenshotArchiveReader::findEntry(bool by_index, int64_t key, int width, HlmArchiveIndexEntry& entry, int& sequence) const {
+    auto entry_key = [by_index](const HlmArchiveIndexEntry& e) { return by_index ? static_cast<int64_t>(e.index) : e.timestamp_ms; };
+
+    // 同一归档内序号和时间都是递增的，先按首尾记录定位索引文件，再二分查找
+    for (size_t i = 0; i < index_files_.size(); i++) {
+        const IndexFile& index_file = index_files_[i];
+        HlmArchiveIndexEntry first, last;
+        if (!readEntry(index_file, 0, first) || !readEntry(index_file, index_file.entries - 1, last)) {
+            continue;
+        }
+        bool last_file = i + 1 == index_files_.size();
+        if (key > entry_key(last) && !(last_file && !by_index)) {
+            continue;
+        }
+        if (key < entry_key(first)) {
+            if (by_index) {
+                continue;
+            }
+            // 按时间查找时取不晚于该时间的最后一张，早于所有截图时取第一张
+            if (i > 0) {
+                const IndexFile& previous = index_files_[i - 1];
+                sequence = previous.sequence;
+                return selectWidth(previous, previous.entries - 1, width, entry);
+            }
+            sequence = index_file.sequence;
+            return selectWidth(index_file, 0, width, entry);
+        }
+
+        // 查找最后一个 key 不大于目标的记录
+        size_t low = 0, high = index_file.entries - 1;
+        while (low < high) {
+            size_t mid = (low + high + 1) / 2;
+            HlmArchiveIndexEntry mid_entry;
+            if (!readEntry(index_file, mid, mid_entry)) {
+                return false;
+            }
+            if (entry_key(mid_entry) <= key) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+
+        HlmArchiveIndexEntry found;
+        if (!readEntry(index_file, low, found) || (by_index && entry_key(found) != key)) {
+            continue;
+        }
+        sequence = index_file.sequence;
+        return selectWidth(index_file, low, width, entry);
+    }
+    return false;
+}
+
+bool HlmScreenshotArchiveReader::selectWidth(const IndexFile& index_file, size_t position, int width, HlmArchiveIndexEntry& entry) const {
+    // 同一张截图的多种尺寸连续存放，回到该截图的第一条记录后按宽度查找
+    HlmArchiveIndexEntry current;
+    if (!readEntry(index_file, position, current)) {
+        return false;
+    }
+    uint32_t index = current.index;
+    while (position > 0) {
+        HlmArchiveIndexEntry previous;
+        if (!readEntry(index_file, position - 1, previous) || previous.index != index) {
+            break;
+        }
+        position--;
+    }
+
+    for (; position < index_file.entries; position++) {
+        if (!readEntry(index_file, position, current) || current.index != index) {
+            break;
+        }
+        if (width < 0 || current.width == static_cast<uint32_t>(width)) {
+            entry = current;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HlmScreenshotArchiveReader::readImage(int sequence, const HlmArchiveIndexEntry& entry, string& image) const {
+    string path = output_dir_ + "/" + HlmScreenshotArchive::packFilename(filename_prefix_, sequence);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        hlm_error("Failed to open screenshot archive: {}", path);
+        return false;
+    }
+
+    // 索引可能先于图片数据落盘，数据不完整时按未找到处理
+    image.resize(entry.size);
+    ssize_t read_bytes = pread(fd, &image[0], entry.size, entry.offset);
+    ::close(fd);
+    if (read_bytes != static_cast<ssize_t>(entry.size)) {
+        hlm_warn("Image {} is not fully written to {} yet.", entry.index, path);
+        image.clear();
+        return false;
+    }
+    return true;
+}
+
+string HlmScreenshotArchiveReader::detectContentType(const string& image) {
+    if (image.size() >= 8 && image.compare(0, 8, "\x89PNG\r\n\x1a\n") == 0) {
+        return "image/png";
+    }
+    if (image.size() >= 3 && image.compare(0, 3, "\xff\xd8\xff") == 0) {
+        return "image/jpeg";
+    }
+    if (image.size() >= 12 && image.compare(0, 4, "RIFF") == 0 && image.compare(8, 4, "WEBP") == 0) {
+        return "image/webp";
+    }
+    return "application/octet-stream";
+}
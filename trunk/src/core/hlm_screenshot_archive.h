@@ -0,0 +1,84 @@
+#ifndef HLM_SCREENSHOT_ARCHIVE_H
+#define HLM_SCREENSHOT_ARCHIVE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hlm_file_writer.h"
+
+using namespace std;
+
+// 归档索引中的一条记录，索引文件由定长记录依次追加组成
+struct HlmArchiveIndexEntry {
+    uint64_t offset;       // 图片在打包文件中的偏移
+    uint32_t size;         // 图片字节数
+    uint32_t index;        // 截图序号，与文件输出模式下文件名中的序号一致
+    int64_t timestamp_ms;  // 截图对应的媒体时间，单位：毫秒
+    uint32_t width;        // 多尺寸输出时的宽度，0 表示原始分辨率
+    uint32_t reserved;
+};
+static_assert(sizeof(HlmArchiveIndexEntry) == 32, "HlmArchiveIndexEntry must be 32 bytes");
+
+// 截图归档：同一任务的图片追加写入滚动的打包文件 <prefix>_<seq>.pack，偏移记录在 <prefix>_<seq>.idx
+class HlmScreenshotArchive {
+   public:
+    HlmScreenshotArchive(const string& output_dir, const string& filename_prefix, shared_ptr<HlmWriteBacklog> backlog);
+    ~HlmScreenshotArchive();
+
+    // 写入服务接管 buffer 的引用
+    bool append(AVBufferRef* buffer, const uint8_t* data, size_t size, int index, int width, double frame_time);
+    void close();
+
+    static string packFilename(const string& filename_prefix, int sequence);
+    static string indexFilename(const string& filename_prefix, int sequence);
+    // 列出目录中某个前缀已有的归档序号，按升序排列
+    static vector<int> listSequences(const string& output_dir, const string& filename_prefix);
+
+   private:
+    void open();
+    bool needsRotation(size_t size) const;
+
+    string output_dir_;
+    string filename_prefix_;
+    shared_ptr<HlmWriteBacklog> backlog_;
+    int64_t max_pack_bytes_;
+    int64_t max_pack_us_;
+
+    int sequence_ = -1;
+    shared_ptr<HlmWriteFile> pack_file_;
+    shared_ptr<HlmWriteFile> index_file_;
+    int64_t pack_size_ = 0;
+    int64_t index_size_ = 0;
+    int64_t opened_at_ = 0;
+};
+
+// 从归档中读取单张截图
+class HlmScreenshotArchiveReader {
+   public:
+    HlmScreenshotArchiveReader(const string& output_dir, const string& filename_prefix);
+
+    // width 小于 0 时返回该序号的第一种尺寸
+    bool readByIndex(int index, int width, string& image) const;
+    bool readByTimestamp(double timestamp, int width, string& image) const;
+    static string detectContentType(const string& image);
+
+   private:
+    struct IndexFile {
+        int sequence;
+        string path;
+        size_t entries;
+    };
+
+    bool readEntry(const IndexFile& index_file, size_t position, HlmArchiveIndexEntry& entry) const;
+    bool findEntry(bool by_index, int64_t key, int width, HlmArchiveIndexEntry& entry, int& sequence) const;
+    bool selectWidth(const IndexFile& index_file, size_t position, int width, HlmArchiveIndexEntry& entry) const;
+    bool readImage(int sequence, const HlmArchiveIndexEntry& entry, string& image) const;
+
+    string output_dir_;
+    string filename_prefix_;
+    vector<IndexFile> index_files_;
+};
+
+#endif  // HLM_SCREENSHOT_ARCHIVE_H
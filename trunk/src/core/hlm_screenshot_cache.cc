@@ -0,0 +1,242 @@
+#include "hlm_screenshot_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "utils/hlm_config.h"
+#include "utils/hlm_logger.h"
+
+HlmScreenshotCache& HlmScreenshotCache::getInstance() {
+    static HlmScreenshotCache instance;
+    return instance;
+}
+
+HlmScreenshotCache::HlmScreenshotCache()
+    : enabled_(CONF.isResultCacheEnabled()),
+      memory_max_bytes_(CONF.getCacheMemoryMaxBytes()),
+      disk_max_bytes_(CONF.getCacheDiskMaxBytes()),
+      dir_(CONF.getCacheDir()) {
+    backlog_ = HlmFileWriter::getInstance().createBacklog("screenshot cache");
+    if (enabled_ && disk_max_bytes_ > 0) {
+        loadDiskIndex();
+    }
+}
+
+bool HlmScreenshotCache::isEnabled() const {
+    return enabled_;
+}
+
+string HlmScreenshotCache::fileKey(const string& url) {
+    string path = url;
+    if (path.find("file:") == 0) {
+        path = path.substr(5);
+    } else if (path.find("://") != string::npos) {
+        return "";
+    }
+
+    error_code ec;
+    auto mtime = filesystem::last_write_time(path, ec);
+    if (ec) {
+        return "";
+    }
+    auto size = filesystem::file_size(path, ec);
+    if (ec) {
+        return "";
+    }
+    return filesystem::absolute(path, ec).string() + "|" + to_string(mtime.time_since_epoch().count()) + "|" + to_string(size);
+}
+
+string HlmScreenshotCache::imageKey(const string& key_base, double time, int width) {
+    ostringstream oss;
+    oss << key_base << "|t=" << fixed << setprecision(3) << time << "|w=" << width;
+    return oss.str();
+}
+
+bool HlmScreenshotCache::get(const string& key, shared_ptr<const string>& image) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = memory_index_.find(key);
+        if (it != memory_index_.end()) {
+            memory_lru_.splice(memory_lru_.begin(), memory_lru_, it->second);
+            image = it->second->image;
+            stats_.memory_hits++;
+            return true;
+        }
+        if (disk_index_.find(diskName(key)) == disk_index_.end()) {
+            stats_.misses++;
+            return false;
+        }
+    }
+
+    // 读磁盘不持有锁，命中后提升到内存
+    bool found = readDisk(key, image);
+    lock_guard<mutex> lock(mutex_);
+    auto it = disk_index_.find(diskName(key));
+    if (!found) {
+        stats_.misses++;
+        return false;
+    }
+    if (it != disk_index_.end()) {
+        disk_lru_.splice(disk_lru_.begin(), disk_lru_, it->second);
+    }
+    insertMemory(key, image);
+    stats_.disk_hits++;
+    return true;
+}
+
+void HlmScreenshotCache::put(const string& key, const uint8_t* data, size_t size) {
+    if (!enabled_) {
+        return;
+    }
+
+    auto image = make_shared<const string>(reinterpret_cast<const char*>(data), size);
+    lock_guard<mutex> lock(mutex_);
+    insertMemory(key, image);
+    if (disk_max_bytes_ > 0) {
+        insertDisk(key, image);
+    }
+    stats_.insertions++;
+}
+
+bool HlmScreenshotCache::writeFile(const string& path, const shared_ptr<const string>& image) {
+    AVBufferRef* buffer = av_buffer_alloc(image->size());
+    if (!buffer) {
+        return false;
+    }
+    memcpy(buffer->data, image->data(), image->size());
+    return HlmFileWriter::getInstance().writeFile(path, backlog_, buffer, buffer->data, image->size(), HlmWritePolicy::Block);
+}
+
+HlmScreenshotCacheStats HlmScreenshotCache::getStats() const {
+    lock_guard<mutex> lock(mutex_);
+    HlmScreenshotCacheStats stats = stats_;
+    stats.memory_entries = memory_index_.size();
+    stats.disk_entries = disk_index_.size();
+    return stats;
+}
+
+void HlmScreenshotCache::loadDiskIndex() {
+    error_code ec;
+    filesystem::create_directories(dir_, ec);
+    if (ec) {
+        hlm_error("Failed to create screenshot cache directory: {}, disk cache disabled.", dir_);
+        disk_max_bytes_ = 0;
+        return;
+    }
+
+    // 重启后按文件修改时间恢复磁盘缓存的 LRU 顺序
+    vector<pair<filesystem::file_time_type, DiskEntry>> entries;
+    for (const auto& file : filesystem::directory_iterator(dir_, ec)) {
+        if (file.is_regular_file(ec) && file.path().extension() == ".img") {
+            entries.push_back({file.last_write_time(ec), {file.path().filename().string(), static_cast<int64_t>(file.file_size(ec))}});
+        }
+    }
+    sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    lock_guard<mutex> lock(mutex_);
+    for (const auto& entry : entries) {
+        disk_lru_.push_back(entry.second);
+        disk_index_[entry.second.name] = prev(disk_lru_.end());
+        stats_.disk_bytes += entry.second.size;
+    }
+    while (stats_.disk_bytes > disk_max_bytes_ && !disk_lru_.empty()) {
+        removeDisk(disk_lru_.back().name);
+    }
+    hlm_info("Screenshot cache loaded {} entries ({} bytes) from {}", disk_index_.size(), stats_.disk_bytes, dir_);
+}
+
+string HlmScreenshotCache::diskName(const string& key) {
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << hash<string>()(key) << ".img";
+    return oss.str();
+}
+
+bool HlmScreenshotCache::readDisk(const string& key, shared_ptr<const string>& image) {
+    // 磁盘文件格式：HLMC <图片字节数>\n<key>\n<图片数据>，key 不一致（哈希冲突）或长度不足（尚未写完）时视为未命中
+    ifstream file(dir_ + "/" + diskName(key), ios::binary);
+    string magic;
+    size_t size = 0;
+    string stored_key;
+    if (!(file >> magic >> size) || magic != DISK_MAGIC || file.get() != '\n' || !getline(file, stored_key) || stored_key != key) {
+        return false;
+    }
+
+    string data(size, '\0');
+    if (!file.read(&data[0], size)) {
+        return false;
+    }
+    image = make_shared<const string>(move(data));
+    return true;
+}
+
+void HlmScreenshotCache::insertMemory(const string& key, shared_ptr<const string> image) {
+    auto it = memory_index_.find(key);
+    if (it != memory_index_.end()) {
+        stats_.memory_bytes -= it->second->image->size();
+        memory_lru_.erase(it->second);
+        memory_index_.erase(it);
+    }
+    if (static_cast<int64_t>(image->size()) > memory_max_bytes_) {
+        return;
+    }
+
+    memory_lru_.push_front({key, image});
+    memory_index_[key] = memory_lru_.begin();
+    stats_.memory_bytes += image->size();
+    while (stats_.memory_bytes > memory_max_bytes_) {
+        const MemoryEntry& oldest = memory_lru_.back();
+        stats_.memory_bytes -= oldest.image->size();
+        memory_index_.erase(oldest.key);
+        memory_lru_.pop_back();
+        stats_.evictions++;
+    }
+}
+
+void HlmScreenshotCache::insertDisk(const string& key, const shared_ptr<const string>& image) {
+    string header = string(DISK_MAGIC) + " " + to_string(image->size()) + "\n" + key + "\n";
+    int64_t size = header.size() + image->size();
+    AVBufferRef* buffer = av_buffer_alloc(size);
+    if (!buffer) {
+        return;
+    }
+    memcpy(buffer->data, header.data(), header.size());
+    memcpy(buffer->data + header.size(), image->data(), image->size());
+
+    string name = diskName(key);
+    if (!HlmFileWriter::getInstance().writeFile(dir_ + "/" + name, backlog_, buffer, buffer->data, size, HlmWritePolicy::Drop)) {
+        hlm_warn("Write backlog is full, screenshot not cached on disk: {}", key);
+        return;
+    }
+
+    auto it = disk_index_.find(name);
+    if (it != disk_index_.end()) {
+        stats_.disk_bytes -= it->second->size;
+        disk_lru_.erase(it->second);
+        disk_index_.erase(it);
+    }
+    disk_lru_.push_front({name, size});
+    disk_index_[name] = disk_lru_.begin();
+    stats_.disk_bytes += size;
+    while (stats_.disk_bytes > disk_max_bytes_ && disk_lru_.size() > 1) {
+        removeDisk(disk_lru_.back().name);
+        stats_.evictions++;
+    }
+}
+
+void HlmScreenshotCache::removeDisk(const string& name) {
+    auto it = disk_index_.find(name);
+    if (it == disk_index_.end()) {
+        return;
+    }
+    stats_.disk_bytes -= it->second->size;
+    disk_lru_.erase(it->second);
+    disk_index_.erase(it);
+
+    error_code ec;
+    filesystem::remove(dir_ + "/" + name, ec);
+}
@@ -0,0 +1,83 @@
+#ifndef HLM_SCREENSHOT_CACHE_H
+#define HLM_SCREENSHOT_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "hlm_file_writer.h"
+
+using namespace std;
+
+struct HlmScreenshotCacheStats {
+    uint64_t memory_hits = 0;     // 内存命中次数
+    uint64_t disk_hits = 0;       // 磁盘命中次数
+    uint64_t misses = 0;          // 未命中次数
+    uint64_t insertions = 0;      // 写入缓存的图片数
+    uint64_t evictions = 0;       // 超过大小上限被淘汰的图片数（内存和磁盘合计）
+    size_t memory_entries = 0;
+    int64_t memory_bytes = 0;
+    size_t disk_entries = 0;
+    int64_t disk_bytes = 0;
+};
+
+// 文件截图结果缓存：内存和磁盘两级 LRU，key 由输入文件路径、修改时间、大小和截图参数组成，
+// 文件被修改后 key 随之变化，旧结果不会再命中，由 LRU 自然淘汰
+class HlmScreenshotCache {
+   public:
+    static HlmScreenshotCache& getInstance();
+
+    bool isEnabled() const;
+    // 本地文件的 key 前缀，不是本地文件或文件不存在时返回空
+    static string fileKey(const string& url);
+    static string imageKey(const string& key_base, double time, int width);
+
+    bool get(const string& key, shared_ptr<const string>& image);
+    void put(const string& key, const uint8_t* data, size_t size);
+    // 把缓存的图片异步写到文件，用于文件输出方式的请求命中缓存
+    bool writeFile(const string& path, const shared_ptr<const string>& image);
+
+    HlmScreenshotCacheStats getStats() const;
+
+   private:
+    HlmScreenshotCache();
+    HlmScreenshotCache(const HlmScreenshotCache&) = delete;
+    HlmScreenshotCache& operator=(const HlmScreenshotCache&) = delete;
+
+    struct MemoryEntry {
+        string key;
+        shared_ptr<const string> image;
+    };
+
+    struct DiskEntry {
+        string name;
+        int64_t size;
+    };
+
+    void loadDiskIndex();
+    static string diskName(const string& key);
+    bool readDisk(const string& key, shared_ptr<const string>& image);
+    void insertMemory(const string& key, shared_ptr<const string> image);
+    void insertDisk(const string& key, const shared_ptr<const string>& image);
+    void removeDisk(const string& name);
+
+    bool enabled_;
+    int64_t memory_max_bytes_;
+    int64_t disk_max_bytes_;
+    string dir_;
+    shared_ptr<HlmWriteBacklog> backlog_;
+
+    mutable mutex mutex_;
+    list<MemoryEntry> memory_lru_;  // 最近使用的在前
+    unordered_map<string, list<MemoryEntry>::iterator> memory_index_;
+    list<DiskEntry> disk_lru_;
+    unordered_map<string, list<DiskEntry>::iterator> disk_index_;  // 按磁盘文件名索引
+    HlmScreenshotCacheStats stats_;
+
+    static constexpr const char* DISK_MAGIC = "HLMC";
+};
+
+#endif  // HLM_SCREENSHOT_CACHE_H
@@ -1,8 +1,17 @@
 #include "hlm_screenshot_executor.h"
 
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#include "hlm_screenshot_cache.h"
 #include "utils/hlm_logger.h"
+#include "utils/hlm_thread.h"
 #include "utils/hlm_time.h"
 
 // 通用 HlmScreenshotExecutor 基类的实现
@@ -10,8 +19,17 @@ HlmScreenshotExecutor::HlmScreenshotExecutor(const string& stream_url, const str
     : HlmExecutor(stream_url, output_dir, filename_prefix, screenshot_method), screenshot_method_(screenshot_method) {
 }
 
+HlmScreenshotExecutor::~HlmScreenshotExecutor() {
+    clearCandidates();
+    av_frame_free(&best_candidate_.frame);
+    av_buffer_unref(&inline_image_.buffer);
+    if (metadata_file_) {
+        HlmFileWriter::getInstance().close(metadata_file_, false);
+    }
+}
+
 bool HlmScreenshotExecutor::init() {
-    if (!ensureDirectoryExists(output_dir_)) {
+    if (!inline_output_ && !ensureDirectoryExists(output_dir_)) {
         hlm_error("Failed to create or access output directory: {}", output_dir_);
         return false;
     }
@@ -36,11 +54,15 @@ bool HlmScreenshotExecutor::init() {
         return false;
     }
 
-    if (!initScaler()) {
+    if (!initImageScaler()) {
         hlm_error("Failed to initialize scaler for image.");
         return false;
     }
 
+    if (archive_output_) {
+        archive_ = make_unique<HlmScreenshotArchive>(output_dir_, filename_, write_backlog_);
+    }
+
     hlm_info("Media initialization successful for screenshot.");
 
     running_ = true;
@@ -65,15 +87,53 @@ bool HlmScreenshotExecutor::initOutputFile() {
 }
 
 bool HlmScreenshotExecutor::initEncoder() {
-    if (input_video_stream_index_ != -1) {
-        video_encoder_ = new HlmEncoder();
-        if (!video_encoder_->initEncoderForImage(video_decoder_->getCodecContext(), "png")) {
+    if (input_video_stream_index_ == -1) {
+        return false;
+    }
+
+    // 每种输出尺寸一个编码器，各自缓存缩放上下文，同一解码帧依次缩放编码
+    AVCodecContext* decoder_context = video_decoder_->getCodecContext();
+    rendition_widths_ = image_options_.widths.empty() ? vector<int>{0} : image_options_.widths;
+    for (size_t i = 0; i < rendition_widths_.size(); ++i) {
+        int width = rendition_widths_[i];
+        int height = 0;
+        if (width > 0) {
+            height = max(2, static_cast<int>(av_rescale(decoder_context->height, width, decoder_context->width)) & ~1);
+        }
+
+        HlmEncoder* encoder = new HlmEncoder();
+        if (i == 0) {
+            video_encoder_ = encoder;
+        } else {
+            rendition_encoders_.emplace_back(encoder);
+        }
+        if (!encoder->initImageEncoder(decoder_context, image_options_, width, height)) {
             hlm_error("Failed to initialize video encoder for image.");
             return false;
         }
-        return true;
     }
-    return false;
+    return true;
+}
+
+bool HlmScreenshotExecutor::initImageScaler() {
+    AVCodecContext* decoder_context = video_decoder_->getCodecContext();
+    for (size_t i = 0; i < rendition_widths_.size(); ++i) {
+        HlmEncoder* encoder = renditionEncoder(i);
+        AVCodecContext* encoder_context = encoder->getContext();
+        if (decoder_context->pix_fmt == encoder_context->pix_fmt && decoder_context->width == encoder_context->width && decoder_context->height == encoder_context->height) {
+            hlm_info("Decoded frames ({}) are encoded directly without scaling.", av_get_pix_fmt_name(encoder_context->pix_fmt));
+            continue;
+        }
+        if (!encoder->initScaler(decoder_context->width, decoder_context->height, decoder_context->pix_fmt,
+                                 encoder_context->width, encoder_context->height, encoder_context->pix_fmt)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+HlmEncoder* HlmScreenshotExecutor::renditionEncoder(size_t rendition) const {
+    return rendition == 0 ? video_encoder_ : rendition_encoders_[rendition - 1].get();
 }
 
 void HlmScreenshotExecutor::execute() {
@@ -83,13 +143,40 @@ void HlmScreenshotExecutor::execute() {
         return;
     }
 
+    capture_targets_ = computeCaptureTargets();
+    if (!capture_targets_.empty()) {
+        // 归档输出由一个任务顺序追加，去重需要和前一张截图比较，都不拆分区间
+        bool sequential = archive_output_ || dedup_distance_ >= 0;
+        int ranges = sequential ? 1 : min<int>(parallel_ranges_, capture_targets_.size() / MIN_TARGETS_PER_RANGE);
+        if (ranges > 1) {
+            captureTargetsInParallel(ranges);
+        } else {
+            captureTargets();
+        }
+        flushEncoder();
+        hlm_info("{} stopped for stream: {}", media_method_, stream_url_);
+        return;
+    }
+
     AVPacket* packet = av_packet_alloc();
     AVFrame* frame = av_frame_alloc();
 
-    while (isRunning() && av_read_frame(input_format_context_, packet) >= 0) {
+    while (isRunning()) {
+        HlmInputResult result = readInput(packet, frame);
+        if (result == HlmInputResult::End) {
+            break;
+        }
         updateStartTime();
 
-        if (packet->stream_index == input_video_stream_index_) {
+        if (result == HlmInputResult::Frame) {
+            processFrames(frame, input_video_stream_index_);
+            av_frame_unref(frame);
+            continue;
+        }
+
+        // 关键帧模式下非关键帧不送入解码器
+        bool skip_packet = keyframesOnly() && !(packet->flags & AV_PKT_FLAG_KEY);
+        if (packet->stream_index == input_video_stream_index_ && !skip_packet) {
             if (video_decoder_->decodePacket(packet, frame)) {
                 processFrames(frame, packet->stream_index);
             }
@@ -104,45 +191,483 @@ void HlmScreenshotExecutor::execute() {
     hlm_info("{} stopped for stream: {}", media_method_, stream_url_);
 }
 
+void HlmScreenshotExecutor::checkAndSavePacket(AVPacket* encoded_packet, int stream_index) {
+    savePacketAsImage(encoded_packet);
+}
+
 void HlmScreenshotExecutor::processFrames(AVFrame* frame, int stream_index) {
-    int64_t pts = frame->pts;
-    double frame_time = pts * av_q2d(input_format_context_->streams[input_video_stream_index_]->time_base);
-    hlm_debug("Processing {} screenshot. PTS: {}, time: {}s, key frame: {}", screenshot_method_, pts, frame_time, frame->key_frame);
+    // 立即截图和指定时间点截图完成后会停止任务，刷新解码器时不再重复截图
+    if (!isRunning() || stream_index != input_video_stream_index_) {
+        return;
+    }
+
+    double frame_time = getFrameTime(frame);
+    hlm_debug("Processing {} screenshot. PTS: {}, time: {}s, key frame: {}", screenshot_method_, frame->pts, frame_time, frame->key_frame);
+
+    if (!shouldCaptureFrame(frame, frame_time)) {
+        return;
+    }
+    saveFrame(frame, frame_time);
+}
+
+void HlmScreenshotExecutor::saveFrame(AVFrame* frame, double frame_time) {
+    // 重复画面不编码保存，但和截图一样推进间隔和目标
+    if (isDuplicateFrame(frame, frame_time)) {
+        onCaptured(frame_time);
+        return;
+    }
+    captureFrame(frame, frame_time);
+}
+
+void HlmScreenshotExecutor::setParallelRanges(int parallel_ranges) {
+    parallel_ranges_ = max(1, parallel_ranges);
+}
+
+void HlmScreenshotExecutor::setImageOptions(const HlmImageOptions& image_options) {
+    image_options_ = image_options;
+}
+
+void HlmScreenshotExecutor::setArchiveOutput(bool archive_output) {
+    archive_output_ = archive_output;
+}
+
+void HlmScreenshotExecutor::setDedupDistance(int dedup_distance) {
+    dedup_distance_ = dedup_distance;
+}
+
+void HlmScreenshotExecutor::setSharpestWindow(int sharpest_window) {
+    sharpest_window_ = sharpest_window;
+}
+
+void HlmScreenshotExecutor::setInlineOutput(bool inline_output) {
+    inline_output_ = inline_output;
+}
+
+void HlmScreenshotExecutor::setCacheKeyBase(const string& cache_key_base) {
+    cache_key_base_ = cache_key_base;
+}
+
+bool HlmScreenshotExecutor::takeInlineImage(HlmInlineImage& image) {
+    if (!inline_image_.buffer) {
+        return false;
+    }
+    image = inline_image_;
+    inline_image_ = HlmInlineImage();
+    return true;
+}
+
+string HlmScreenshotExecutor::metadataFilename(const string& filename_prefix) {
+    return filename_prefix + "_meta.jsonl";
+}
+
+string HlmScreenshotExecutor::imageFilename(const string& filename_prefix, int index, const string& image_format, int width) {
+    string extension = image_format == HlmImageFormat::Jpeg ? "jpg" : image_format;
+    string size_suffix = width > 0 ? "_" + to_string(width) + "w" : "";
+    return filename_prefix + "_" + to_string(index) + size_suffix + "." + extension;
+}
+
+void HlmScreenshotExecutor::captureFrame(AVFrame* frame, double frame_time) {
+    capture_time_ = frame_time;
+    int index = capture_targets_.empty() ? frame_count_ : target_index_offset_ + static_cast<int>(next_target_);
+    bool captured = false;
+    for (size_t i = 0; i < rendition_widths_.size(); ++i) {
+        rendition_width_ = rendition_widths_[i];
+        if (captureRendition(renditionEncoder(i), frame, frame_time)) {
+            captured = true;
+        }
+    }
+    if (captured) {
+        if (dedup_distance_ >= 0) {
+            last_saved_hash_ = frame_hash_;
+            has_saved_hash_ = true;
+            if (!inline_output_) {
+                writeMetadata(index, frame_time);
+            }
+        }
+        // 同一帧的各种尺寸共用一个输出序号，按目标截图时序号取目标序号
+        if (capture_targets_.empty()) {
+            frame_count_++;
+        }
+        onCaptured(frame_time);
+    }
+}
+
+bool HlmScreenshotExecutor::isDuplicateFrame(AVFrame* frame, double frame_time) {
+    if (dedup_distance_ < 0) {
+        return false;
+    }
+    if (!hash_sampler_) {
+        hash_sampler_ = make_unique<HlmLumaSampler>(HLM_DHASH_WIDTH, HLM_DHASH_HEIGHT);
+    }
+    if (!hash_sampler_->sample(frame, hash_luma_)) {
+        return false;
+    }
+
+    frame_hash_ = hlmDifferenceHash(hash_luma_);
+    if (!has_saved_hash_) {
+        return false;
+    }
+    int distance = hlmHammingDistance(frame_hash_, last_saved_hash_);
+    if (distance > dedup_distance_) {
+        return false;
+    }
+    hlm_info("Skipping duplicate frame at {}s of {} (hash distance: {}).", frame_time, stream_url_, distance);
+    return true;
+}
+
+void HlmScreenshotExecutor::writeMetadata(int index, double frame_time) {
+    if (!metadata_file_) {
+        metadata_file_ = HlmFileWriter::getInstance().openFile(output_dir_ + "/" + metadataFilename(filename_), write_backlog_);
+    }
+
+    ostringstream line;
+    line << "{\"index\":" << index << ",\"time\":" << fixed << setprecision(3) << frame_time
+         << ",\"phash\":\"" << hex << setw(16) << setfill('0') << frame_hash_ << "\"}\n";
+    string data = line.str();
+
+    AVBufferRef* buffer = av_buffer_alloc(data.size());
+    if (!buffer) {
+        hlm_error("Failed to allocate buffer for screenshot metadata of {}", filename_);
+        return;
+    }
+    memcpy(buffer->data, data.data(), data.size());
+    // 元数据很小，积压已满时等待，保证和图片一一对应
+    HlmFileWriter::getInstance().write(metadata_file_, metadata_size_, buffer, buffer->data, data.size(), HlmWritePolicy::Block);
+    metadata_size_ += data.size();
+}
 
-    AVFrame* scaled_frame = video_encoder_->scaleFrame(frame);
+bool HlmScreenshotExecutor::captureRendition(HlmEncoder* encoder, AVFrame* frame, double frame_time) {
+    // 解码帧的像素格式和尺寸与编码器一致时直接编码，否则先缩放
+    AVFrame* scaled_frame = frame;
+    AVCodecContext* encoder_context = encoder->getContext();
+    if (frame->format != encoder_context->pix_fmt || frame->width != encoder_context->width || frame->height != encoder_context->height) {
+        if (!encoder->hasScaler() &&
+            !encoder->initScaler(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                 encoder_context->width, encoder_context->height, encoder_context->pix_fmt)) {
+            hlm_error("Failed to initialize scaler for frame format {}.", av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)));
+            return false;
+        }
+        scaled_frame = encoder->scaleFrame(frame);
+    }
     if (!scaled_frame) {
         hlm_error("Failed to scale frame for saving.");
-        return;
+        return false;
     }
 
+    bool encoded = false;
     AVPacket* encoded_packet = av_packet_alloc();
-    if (video_encoder_->encodeFrame(scaled_frame, encoded_packet)) {
-        checkAndSavePacket(encoded_packet, input_video_stream_index_);
+    if (encoder->encodeFrame(scaled_frame, encoded_packet)) {
+        if (capture_targets_.empty()) {
+            checkAndSavePacket(encoded_packet, input_video_stream_index_);
+        } else {
+            // 按目标截图时输出序号取目标序号，拆分并行后的文件名与串行执行一致；
+            // 同一帧满足多个目标时每个目标各保存一份，保证输出文件与目标一一对应
+            size_t last_target = lastReachedTarget(frame_time);
+            for (size_t target = next_target_; target <= last_target; ++target) {
+                frame_count_ = target_index_offset_ + static_cast<int>(target);
+                checkAndSavePacket(encoded_packet, input_video_stream_index_);
+                if (!cache_key_base_.empty()) {
+                    string key = HlmScreenshotCache::imageKey(cache_key_base_, capture_targets_[target], rendition_width_);
+                    HlmScreenshotCache::getInstance().put(key, encoded_packet->data, encoded_packet->size);
+                }
+            }
+        }
         av_packet_unref(encoded_packet);
+        encoded = true;
     } else {
         hlm_error("Failed to encode frame.");
     }
     av_packet_free(&encoded_packet);
+    return encoded;
+}
+
+double HlmScreenshotExecutor::getFrameTime(AVFrame* frame) const {
+    int64_t pts = frame->pts != AV_NOPTS_VALUE ? frame->pts : frame->best_effort_timestamp;
+    return pts * av_q2d(input_format_context_->streams[input_video_stream_index_]->time_base);
+}
+
+bool HlmScreenshotExecutor::seekTo(double target_time) {
+    AVRational time_base = input_format_context_->streams[input_video_stream_index_]->time_base;
+    int64_t target_ts = static_cast<int64_t>(target_time / av_q2d(time_base));
+    if (av_seek_frame(input_format_context_, input_video_stream_index_, target_ts, AVSEEK_FLAG_BACKWARD) < 0) {
+        hlm_warn("Failed to seek to {}s in {}, decoding forward instead.", target_time, stream_url_);
+        return false;
+    }
+
+    avcodec_flush_buffers(video_decoder_->getCodecContext());
+    hlm_debug("Seeked to keyframe before {}s in {}", target_time, stream_url_);
+    return true;
+}
+
+void HlmScreenshotExecutor::captureTargets() {
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* last_frame = av_frame_alloc();
+    double position = -1;
+    bool eof = false;
+
+    // 每一帧只和当前目标比较，达到目标即截图，未达到时保留为最近一帧，用于文件末尾的兜底截图；
+    // 选择最清晰帧时目标前后的帧都作为候选，评估完窗口后只编码最清晰的一帧
+    auto handle_frame = [&](AVFrame* frame, int stream_index) {
+        position = getFrameTime(frame);
+        if (selecting_ && !continueSelection(frame, position)) {
+            return;
+        }
+        if (reachedNextTarget(position)) {
+            if (sharpest_window_ != 0) {
+                beginSelection(frame, position);
+            } else {
+                processFrames(frame, stream_index);
+            }
+        } else {
+            av_frame_unref(last_frame);
+            av_frame_ref(last_frame, frame);
+            if (sharpest_window_ != 0) {
+                addPrecedingCandidate(frame, position);
+            }
+        }
+    };
+
+    double duration = input_format_context_->duration > 0 ? input_format_context_->duration / static_cast<double>(AV_TIME_BASE) : 0;
+    while (isRunning() && !eof && next_target_ < capture_targets_.size()) {
+        double target = capture_targets_[next_target_];
+        if (position < 0 || target < position || target - position > SEEK_MIN_DISTANCE) {
+            seekTo(target);
+            av_frame_unref(last_frame);
+            clearCandidates();
+        }
+
+        size_t target_index = next_target_;
+        while (isRunning() && next_target_ == target_index) {
+            if (av_read_frame(input_format_context_, packet) < 0) {
+                eof = true;
+                break;
+            }
+            updateStartTime();
+
+            if (packet->stream_index == input_video_stream_index_) {
+                video_decoder_->decodePacket(packet, handle_frame);
+            }
+            av_packet_unref(packet);
+        }
+
+        if (eof) {
+            video_decoder_->flushDecoder(handle_frame);
+            // 文件结束时目标之后的帧不足窗口大小，直接使用已评估的最清晰帧
+            if (selecting_) {
+                finishSelection();
+            }
+            // 实际视频时长可能小于容器时长，目标在时长内却没有更晚的帧时，截取最后一帧
+            if (isRunning() && next_target_ == target_index && last_frame->data[0] && target <= duration) {
+                double last_time = getFrameTime(last_frame);
+                if (isDuplicateFrame(last_frame, last_time)) {
+                    onCaptured(last_time);
+                } else {
+                    captureFrame(last_frame, last_time);
+                }
+            }
+        }
+    }
+
+    if (next_target_ < capture_targets_.size()) {
+        hlm_warn("Reached end of {} with {} of {} capture targets left.", stream_url_, capture_targets_.size() - next_target_, capture_targets_.size());
+    }
+
+    clearCandidates();
+    av_frame_free(&last_frame);
+    av_packet_free(&packet);
+}
+
+void HlmScreenshotExecutor::addPrecedingCandidate(AVFrame* frame, double frame_time) {
+    // GOP 模式从关键帧开始重新收集，只需要保留其中最清晰的一帧
+    if (sharpest_window_ == HLM_SHARPEST_WINDOW_GOP && frame->key_frame) {
+        clearCandidates();
+    }
+
+    double sharpness = sharpness_meter_.measure(frame);
+    if (sharpest_window_ == HLM_SHARPEST_WINDOW_GOP) {
+        if (!preceding_candidates_.empty() && preceding_candidates_.front().sharpness >= sharpness) {
+            return;
+        }
+        clearCandidates();
+    }
+
+    preceding_candidates_.push_back({av_frame_clone(frame), frame_time, sharpness});
+    if (preceding_candidates_.size() > static_cast<size_t>(sharpest_window_)) {
+        av_frame_free(&preceding_candidates_.front().frame);
+        preceding_candidates_.pop_front();
+    }
+}
+
+void HlmScreenshotExecutor::beginSelection(AVFrame* frame, double frame_time) {
+    best_candidate_ = {av_frame_clone(frame), frame_time, sharpness_meter_.measure(frame)};
+    for (auto& candidate : preceding_candidates_) {
+        if (candidate.sharpness > best_candidate_.sharpness) {
+            swap(candidate, best_candidate_);
+        }
+    }
+    clearCandidates();
+
+    selecting_ = true;
+    selection_remaining_ = sharpest_window_;
+    if (selection_remaining_ == 0) {
+        finishSelection();
+    }
+}
+
+bool HlmScreenshotExecutor::continueSelection(AVFrame* frame, double frame_time) {
+    // 返回 true 表示选择已结束，该帧还需按普通帧处理（可能达到下一个目标）；
+    // GOP 模式遇到下一个关键帧时结束选择
+    if (sharpest_window_ == HLM_SHARPEST_WINDOW_GOP && frame->key_frame) {
+        finishSelection();
+        return true;
+    }
+
+    double sharpness = sharpness_meter_.measure(frame);
+    if (sharpness > best_candidate_.sharpness) {
+        av_frame_unref(best_candidate_.frame);
+        av_frame_ref(best_candidate_.frame, frame);
+        best_candidate_.time = frame_time;
+        best_candidate_.sharpness = sharpness;
+    }
+    if (sharpest_window_ != HLM_SHARPEST_WINDOW_GOP && --selection_remaining_ <= 0) {
+        finishSelection();
+        return true;
+    }
+    return false;
+}
+
+void HlmScreenshotExecutor::finishSelection() {
+    selecting_ = false;
+    if (!best_candidate_.frame) {
+        return;
+    }
+    hlm_debug("Sharpest frame for target {}: {}s (sharpness: {})", next_target_, best_candidate_.time, best_candidate_.sharpness);
+    saveFrame(best_candidate_.frame, best_candidate_.time);
+    av_frame_free(&best_candidate_.frame);
+}
+
+void HlmScreenshotExecutor::clearCandidates() {
+    for (auto& candidate : preceding_candidates_) {
+        av_frame_free(&candidate.frame);
+    }
+    preceding_candidates_.clear();
+}
+
+void HlmScreenshotExecutor::captureTargetsInParallel(int ranges) {
+    hlm_info("Splitting {} capture targets of {} into {} ranges.", capture_targets_.size(), stream_url_, ranges);
+
+    vector<unique_ptr<HlmRangeScreenshotExecutor>> range_executors;
+    vector<unique_ptr<HlmThread>> range_threads;
+    atomic<int> finished_ranges{0};
+
+    size_t per_range = (capture_targets_.size() + ranges - 1) / ranges;
+    for (size_t begin = 0; begin < capture_targets_.size(); begin += per_range) {
+        size_t end = min(begin + per_range, capture_targets_.size());
+        vector<double> targets(capture_targets_.begin() + begin, capture_targets_.begin() + end);
+        auto range_executor = make_unique<HlmRangeScreenshotExecutor>(stream_url_, output_dir_, filename_, targets, static_cast<int>(begin), screenshot_method_);
+
+        range_executor->setImageOptions(image_options_);
+        range_executor->setDecoderThreading(decoder_threading_);
+        range_executor->setSharpestWindow(sharpest_window_);
+        range_executor->setCacheKeyBase(cache_key_base_);
+
+        HlmRangeScreenshotExecutor* executor = range_executor.get();
+        string thread_name = "screenshot range " + to_string(range_executors.size());
+        range_threads.push_back(make_unique<HlmThread>(thread_name, [executor, &finished_ranges]() {
+            executor->execute();
+            finished_ranges++;
+        }));
+        range_executors.push_back(move(range_executor));
+    }
+
+    for (auto& range_thread : range_threads) {
+        range_thread->start();
+    }
+
+    // 等待所有区间完成，任务被停止时通知各区间停止
+    bool stop_requested = false;
+    while (finished_ranges < static_cast<int>(range_threads.size())) {
+        if (!isRunning() && !stop_requested) {
+            for (auto& range_executor : range_executors) {
+                range_executor->stop();
+            }
+            stop_requested = true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    for (auto& range_thread : range_threads) {
+        range_thread->stop();
+    }
+    next_target_ = capture_targets_.size();
+    hlm_info("All {} screenshot ranges finished for {}", range_threads.size(), stream_url_);
+}
+
+bool HlmScreenshotExecutor::reachedNextTarget(double frame_time) const {
+    return next_target_ < capture_targets_.size() && frame_time >= capture_targets_[next_target_];
+}
+
+size_t HlmScreenshotExecutor::lastReachedTarget(double frame_time) const {
+    size_t last_target = next_target_;
+    while (last_target + 1 < capture_targets_.size() && capture_targets_[last_target + 1] <= frame_time) {
+        last_target++;
+    }
+    return last_target;
+}
+
+bool HlmScreenshotExecutor::advanceTargets(double frame_time) {
+    if (next_target_ >= capture_targets_.size()) {
+        return true;
+    }
+
+    // 文件末尾兜底截图时帧时间早于目标，只完成当前目标；否则同一帧满足的多个目标只截一张图
+    next_target_++;
+    while (next_target_ < capture_targets_.size() && capture_targets_[next_target_] <= frame_time) {
+        next_target_++;
+    }
+    return next_target_ == capture_targets_.size();
 }
 
 void HlmScreenshotExecutor::savePacketAsImage(AVPacket* encoded_packet) {
-    string output_filename = output_dir_ + "/" + filename_ + "_" + to_string(frame_count_) + ".png";
-    FILE* file = fopen(output_filename.c_str(), "wb");
+    string output_filename = output_dir_ + "/" + imageFilename(filename_, frame_count_, image_options_.format, rendition_width_);
 
-    if (file) {
-        fwrite(encoded_packet->data, 1, encoded_packet->size, file);
-        fclose(file);
-        hlm_info("Frame successfully saved to: {}", output_filename);
-    } else {
-        hlm_error("Failed to open file for saving frame: {}", output_filename);
+    // 编码后的数据交给异步写入服务，解码线程不等待磁盘
+    AVBufferRef* buffer = encoded_packet->buf ? av_buffer_ref(encoded_packet->buf) : nullptr;
+    const uint8_t* data = encoded_packet->data;
+    if (!buffer) {
+        buffer = av_buffer_alloc(encoded_packet->size);
+        if (!buffer) {
+            hlm_error("Failed to allocate buffer for saving frame: {}", output_filename);
+            return;
+        }
+        memcpy(buffer->data, encoded_packet->data, encoded_packet->size);
+        data = buffer->data;
     }
 
-    frame_count_++;
+    // 同步截图只保留编码数据的引用，由 HTTP 响应直接返回
+    if (inline_output_) {
+        av_buffer_unref(&inline_image_.buffer);
+        inline_image_ = {buffer, data, static_cast<size_t>(encoded_packet->size)};
+        hlm_info("Frame {} of {} kept for inline response ({} bytes).", frame_count_, stream_url_, encoded_packet->size);
+        return;
+    }
+
+    if (archive_) {
+        if (archive_->append(buffer, data, encoded_packet->size, frame_count_, rendition_width_, capture_time_)) {
+            hlm_info("Frame {} queued for appending to archive of {}", frame_count_, filename_);
+        } else {
+            hlm_warn("Write backlog is full, dropped frame {} of archive {}", frame_count_, filename_);
+        }
+    } else if (HlmFileWriter::getInstance().writeFile(output_filename, write_backlog_, buffer, data, encoded_packet->size, HlmWritePolicy::Drop)) {
+        hlm_info("Frame queued for saving to: {}", output_filename);
+    } else {
+        hlm_warn("Write backlog is full, dropped frame: {}", output_filename);
+    }
 }
 
 void HlmScreenshotExecutor::flushDecoder() {
     hlm_info("Flushing decoder...");
-    if (video_decoder_) {
+    if (video_decoder_ && owns_video_decoder_) {
         video_decoder_->flushDecoder([this](AVFrame* frame, int stream_index) {
             updateStartTime();
             processFrames(frame, stream_index);
@@ -179,60 +704,324 @@ void HlmScreenshotExecutor::flushEncoder() {
 }
 
 // 按时间间隔截图的实现
-HlmIntervalScreenshotExecutor::HlmIntervalScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int interval, const string& screenshot_method)
-    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), interval_(interval) {}
+HlmIntervalScreenshotExecutor::HlmIntervalScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int interval, bool keyframes_only, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), interval_(interval) {
+    keyframes_only_ = keyframes_only;
+}
 
-void HlmIntervalScreenshotExecutor::checkAndSavePacket(AVPacket* encoded_packet, int stream_index) {
-    double frame_time = encoded_packet->pts * av_q2d(input_format_context_->streams[input_video_stream_index_]->time_base);
+bool HlmIntervalScreenshotExecutor::shouldCapture(double frame_time) {
     hlm_debug("Frame time: {}s, last saved time: {}s, interval: {}s", frame_time, last_saved_timestamp_, interval_);
+    return frame_time - last_saved_timestamp_ >= interval_;
+}
 
-    if (frame_time - last_saved_timestamp_ >= interval_) {
-        savePacketAsImage(encoded_packet);
-        last_saved_timestamp_ = frame_time;
-        hlm_info("Saving frame at time: {}s (interval: {}).", frame_time, interval_);
-    }
+void HlmIntervalScreenshotExecutor::onCaptured(double frame_time) {
+    last_saved_timestamp_ = frame_time;
+    hlm_info("Saving frame at time: {}s (interval: {}).", frame_time, interval_);
 }
 
 // 按百分比截图的实现
 HlmPercentageScreenshotExecutor::HlmPercentageScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int percentage, const string& screenshot_method)
-    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), percentage_(percentage), last_saved_percentage_(0) {}
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), percentage_(percentage) {}
+
+vector<double> HlmPercentageScreenshotExecutor::computeCaptureTargets() {
+    vector<double> targets;
+    if (input_format_context_->duration <= 0) {
+        hlm_error("Unknown duration for {}, unable to take percentage screenshots.", stream_url_);
+        return targets;
+    }
+
+    double total_duration = input_format_context_->duration / static_cast<double>(AV_TIME_BASE);
+    for (int current_percentage = percentage_; current_percentage <= 100; current_percentage += percentage_) {
+        targets.push_back(total_duration * current_percentage / 100.0);
+    }
+    hlm_info("Percentage screenshot targets for {}: {} captures over {}s", stream_url_, targets.size(), total_duration);
+    return targets;
+}
 
-void HlmPercentageScreenshotExecutor::checkAndSavePacket(AVPacket* encoded_packet, int stream_index) {
-    // 实际视频时长可能会小于显示视频时长，导致达不到100%而少一张图片，后续解决
-    double frame_time = encoded_packet->pts * av_q2d(input_format_context_->streams[input_video_stream_index_]->time_base);
-    double total_duration = input_format_context_->duration / AV_TIME_BASE;
-    double current_percentage = (frame_time / total_duration) * 100;
-    hlm_debug("Current percentage: {}%, last saved percentage: {}%, target percentage: {}%, frame_time:{}s, total_duration:{}",
-              current_percentage, last_saved_percentage_, percentage_, frame_time, total_duration);
+bool HlmPercentageScreenshotExecutor::shouldCapture(double frame_time) {
+    hlm_debug("Frame time: {}s, next target: {}/{}", frame_time, next_target_, capture_targets_.size());
+    return reachedNextTarget(frame_time);
+}
 
-    if (current_percentage - last_saved_percentage_ >= percentage_) {
-        savePacketAsImage(encoded_packet);
-        last_saved_percentage_ = current_percentage;
-        hlm_info("Saving frame at percentage: {}% (interval: {}%).", current_percentage, percentage_);
+void HlmPercentageScreenshotExecutor::onCaptured(double frame_time) {
+    hlm_info("Saving frame at time: {}s (percentage: {}%, interval: {}%).", frame_time, (next_target_ + 1) * percentage_, percentage_);
+    if (advanceTargets(frame_time)) {
+        stop();
     }
 }
 
 // 立即截图的实现
-HlmImmediateScreenshotExecutor::HlmImmediateScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const string& screenshot_method)
-    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method) {}
+HlmImmediateScreenshotExecutor::HlmImmediateScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, bool keyframes_only, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method) {
+    keyframes_only_ = keyframes_only;
+}
 
-void HlmImmediateScreenshotExecutor::checkAndSavePacket(AVPacket* encoded_packet, int stream_index) {
-    savePacketAsImage(encoded_packet);
+bool HlmImmediateScreenshotExecutor::shouldCapture(double frame_time) {
+    return true;
+}
+
+void HlmImmediateScreenshotExecutor::onCaptured(double frame_time) {
     hlm_info("Saving frame at immediate.");
     stop();
 }
 
 // 指定时间点截图的实现
-HlmSpecificTimeScreenshotExecutor::HlmSpecificTimeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int time_second, const string& screenshot_method)
-    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), time_second_(time_second) {}
+HlmSpecificTimeScreenshotExecutor::HlmSpecificTimeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const vector<int>& time_seconds, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), time_seconds_(time_seconds) {}
+
+vector<double> HlmSpecificTimeScreenshotExecutor::computeCaptureTargets() {
+    // 多个时间点按升序在一次解码中依次 seek 截取
+    return vector<double>(time_seconds_.begin(), time_seconds_.end());
+}
+
+bool HlmSpecificTimeScreenshotExecutor::shouldCapture(double frame_time) {
+    hlm_debug("Frame time: {}s, target time: {}s", frame_time, capture_targets_[next_target_]);
+    return reachedNextTarget(frame_time);
+}
+
+void HlmSpecificTimeScreenshotExecutor::onCaptured(double frame_time) {
+    hlm_info("Saving frame at time: {}s (target time: {}s).", frame_time, capture_targets_[next_target_]);
+    if (advanceTargets(frame_time)) {
+        stop();
+    }
+}
+
+
+// 按时间区间截图的实现
+HlmRangeScreenshotExecutor::HlmRangeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const vector<double>& targets, int first_index, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), targets_(targets) {
+    target_index_offset_ = first_index;
+}
+
+vector<double> HlmRangeScreenshotExecutor::computeCaptureTargets() {
+    return targets_;
+}
+
+bool HlmRangeScreenshotExecutor::shouldCapture(double frame_time) {
+    return reachedNextTarget(frame_time);
+}
+
+void HlmRangeScreenshotExecutor::onCaptured(double frame_time) {
+    hlm_info("Saving frame at time: {}s (range target {}).", frame_time, target_index_offset_ + next_target_);
+    if (advanceTargets(frame_time)) {
+        stop();
+    }
+}
+
+// 场景变化截图的实现
+HlmSceneChangeScreenshotExecutor::HlmSceneChangeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, double threshold, double min_interval, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method),
+      threshold_(threshold),
+      min_interval_(min_interval),
+      luma_sampler_(SAMPLE_WIDTH, SAMPLE_HEIGHT) {}
 
-void HlmSpecificTimeScreenshotExecutor::checkAndSavePacket(AVPacket* encoded_packet, int stream_index) {
-    double frame_time = encoded_packet->pts * av_q2d(input_format_context_->streams[input_video_stream_index_]->time_base);
-    hlm_debug("Frame time: {}s, target time: {}s", frame_time, time_second_);
+bool HlmSceneChangeScreenshotExecutor::shouldCapture(double frame_time) {
+    return last_saved_timestamp_ < 0 || frame_time - last_saved_timestamp_ >= min_interval_;
+}
+
+bool HlmSceneChangeScreenshotExecutor::shouldCaptureFrame(AVFrame* frame, double frame_time) {
+    // 未到最小间隔的帧不做分析
+    if (!shouldCapture(frame_time) || !luma_sampler_.sample(frame, current_luma_)) {
+        return false;
+    }
+
+    // 第一帧总是截图，之后与上一张截图比较，缓慢变化累积超过阈值也会截图
+    if (reference_luma_.empty()) {
+        return true;
+    }
+    double diff = hlmMeanAbsDiff(current_luma_, reference_luma_);
+    hlm_debug("Scene difference at {}s: {} (threshold: {})", frame_time, diff, threshold_);
+    return diff >= threshold_;
+}
+
+void HlmSceneChangeScreenshotExecutor::onCaptured(double frame_time) {
+    hlm_info("Saving frame on scene change at time: {}s", frame_time);
+    reference_luma_.swap(current_luma_);
+    last_saved_timestamp_ = frame_time;
+}
+
+// 雪碧图截图的实现
+HlmStoryboardScreenshotExecutor::HlmStoryboardScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const HlmStoryboardParams& params, const string& screenshot_method)
+    : HlmScreenshotExecutor(stream_url, output_dir, filename_prefix, screenshot_method), params_(params) {}
+
+HlmStoryboardScreenshotExecutor::~HlmStoryboardScreenshotExecutor() {
+    if (tile_sws_ctx_) {
+        sws_freeContext(tile_sws_ctx_);
+        tile_sws_ctx_ = nullptr;
+    }
+
+    if (sheet_frame_) {
+        av_frame_free(&sheet_frame_);
+    }
+}
+
+string HlmStoryboardScreenshotExecutor::vttFilename(const string& filename_prefix) {
+    return filename_prefix + ".vtt";
+}
+
+void HlmStoryboardScreenshotExecutor::execute() {
+    HlmScreenshotExecutor::execute();
+    if (!sheet_frame_) {
+        return;
+    }
+
+    // 最后一张未填满的雪碧图也需要保存
+    if (sheet_tiles_ > 0) {
+        saveSheet();
+    }
+    if (!cues_.empty()) {
+        writeVtt();
+    }
+}
+
+vector<double> HlmStoryboardScreenshotExecutor::computeCaptureTargets() {
+    vector<double> targets;
+    if (input_format_context_->duration <= 0) {
+        hlm_error("Unknown duration for {}, unable to build storyboard.", stream_url_);
+        return targets;
+    }
+
+    double total_duration = input_format_context_->duration / static_cast<double>(AV_TIME_BASE);
+    for (double target = 0; target < total_duration; target += params_.interval) {
+        targets.push_back(target);
+    }
+    hlm_info("Storyboard targets for {}: {} tiles over {}s", stream_url_, targets.size(), total_duration);
+    return targets;
+}
 
-    if (frame_time >= time_second_) {
-        savePacketAsImage(encoded_packet);
-        hlm_info("Saving frame at time: {}s (target time: {}s).", frame_time, time_second_);
+bool HlmStoryboardScreenshotExecutor::shouldCapture(double frame_time) {
+    return reachedNextTarget(frame_time);
+}
+
+void HlmStoryboardScreenshotExecutor::onCaptured(double frame_time) {
+    if (advanceTargets(frame_time)) {
         stop();
     }
 }
+
+bool HlmStoryboardScreenshotExecutor::initEncoder() {
+    if (input_video_stream_index_ == -1) {
+        return false;
+    }
+
+    AVCodecContext* decoder_context = video_decoder_->getCodecContext();
+    tile_height_ = max(2, static_cast<int>(av_rescale(decoder_context->height, params_.tile_width, decoder_context->width)) & ~1);
+
+    // 整张雪碧图只编码一次
+    video_encoder_ = new HlmEncoder();
+    if (!video_encoder_->initImageEncoder(decoder_context, image_options_, params_.tile_width * params_.columns, tile_height_ * params_.rows)) {
+        hlm_error("Failed to initialize storyboard encoder.");
+        return false;
+    }
+    rendition_widths_ = {0};
+    return true;
+}
+
+bool HlmStoryboardScreenshotExecutor::initImageScaler() {
+    AVCodecContext* encoder_context = video_encoder_->getContext();
+    sheet_frame_ = av_frame_alloc();
+    if (!sheet_frame_) {
+        hlm_error("Failed to allocate storyboard frame.");
+        return false;
+    }
+
+    sheet_frame_->width = encoder_context->width;
+    sheet_frame_->height = encoder_context->height;
+    sheet_frame_->format = encoder_context->pix_fmt;
+    sheet_frame_->color_range = encoder_context->pix_fmt == AV_PIX_FMT_YUVJ420P ? AVCOL_RANGE_JPEG : encoder_context->color_range;
+    if (av_frame_get_buffer(sheet_frame_, 32) < 0) {
+        hlm_error("Failed to allocate buffer for storyboard frame.");
+        return false;
+    }
+    return true;
+}
+
+void HlmStoryboardScreenshotExecutor::captureFrame(AVFrame* frame, double frame_time) {
+    // 同一帧满足多个目标时每个目标各占一格，保证索引与时间点一一对应
+    size_t last_target = lastReachedTarget(frame_time);
+    for (size_t target = next_target_; target <= last_target; ++target) {
+        int tiles_per_sheet = params_.columns * params_.rows;
+        if (sheet_tiles_ == 0) {
+            ptrdiff_t linesize[4] = {sheet_frame_->linesize[0], sheet_frame_->linesize[1], sheet_frame_->linesize[2], sheet_frame_->linesize[3]};
+            av_image_fill_black(sheet_frame_->data, linesize, static_cast<AVPixelFormat>(sheet_frame_->format),
+                                sheet_frame_->color_range, sheet_frame_->width, sheet_frame_->height);
+        }
+        placeTile(frame, sheet_tiles_);
+
+        double start = capture_targets_[target];
+        double end = target + 1 < capture_targets_.size() ? capture_targets_[target + 1] : input_format_context_->duration / static_cast<double>(AV_TIME_BASE);
+        int x = (sheet_tiles_ % params_.columns) * params_.tile_width;
+        int y = (sheet_tiles_ / params_.columns) * tile_height_;
+        cues_.push_back({start, end, sheet_index_, x, y});
+
+        if (++sheet_tiles_ == tiles_per_sheet) {
+            saveSheet();
+        }
+    }
+    onCaptured(frame_time);
+}
+
+void HlmStoryboardScreenshotExecutor::placeTile(AVFrame* frame, int tile_index) {
+    AVPixelFormat sheet_pix_fmt = static_cast<AVPixelFormat>(sheet_frame_->format);
+    tile_sws_ctx_ = sws_getCachedContext(tile_sws_ctx_, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                         params_.tile_width, tile_height_, sheet_pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!tile_sws_ctx_) {
+        hlm_error("Failed to initialize storyboard tile scaler.");
+        return;
+    }
+
+    // 直接缩放到雪碧图中该格的位置，不经过中间帧
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(sheet_pix_fmt);
+    int x = (tile_index % params_.columns) * params_.tile_width;
+    int y = (tile_index / params_.columns) * tile_height_;
+    uint8_t* tile_data[4] = {nullptr};
+    for (int plane = 0; plane < 4 && sheet_frame_->data[plane]; ++plane) {
+        bool chroma = (plane == 1 || plane == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        int plane_y = chroma ? (y >> desc->log2_chroma_h) : y;
+        tile_data[plane] = sheet_frame_->data[plane] + plane_y * sheet_frame_->linesize[plane] + av_image_get_linesize(sheet_pix_fmt, x, plane);
+    }
+    sws_scale(tile_sws_ctx_, frame->data, frame->linesize, 0, frame->height, tile_data, sheet_frame_->linesize);
+}
+
+void HlmStoryboardScreenshotExecutor::saveSheet() {
+    AVPacket* encoded_packet = av_packet_alloc();
+    if (video_encoder_->encodeFrame(sheet_frame_, encoded_packet)) {
+        frame_count_ = sheet_index_;
+        checkAndSavePacket(encoded_packet, input_video_stream_index_);
+        av_packet_unref(encoded_packet);
+    } else {
+        hlm_error("Failed to encode storyboard sheet {}.", sheet_index_);
+    }
+    av_packet_free(&encoded_packet);
+
+    // 编码器可能仍引用帧缓冲，下一张雪碧图使用新的缓冲
+    av_frame_make_writable(sheet_frame_);
+    sheet_index_++;
+    sheet_tiles_ = 0;
+}
+
+static string formatVttTime(double seconds) {
+    int64_t total_ms = static_cast<int64_t>(seconds * 1000 + 0.5);
+    ostringstream oss;
+    oss << setfill('0') << setw(2) << total_ms / 3600000 << ":" << setw(2) << total_ms / 60000 % 60 << ":"
+        << setw(2) << total_ms / 1000 % 60 << "." << setw(3) << total_ms % 1000;
+    return oss.str();
+}
+
+bool HlmStoryboardScreenshotExecutor::writeVtt() {
+    string vtt_path = output_dir_ + "/" + vttFilename(filename_);
+    ofstream vtt(vtt_path);
+    if (!vtt) {
+        hlm_error("Failed to open storyboard index: {}", vtt_path);
+        return false;
+    }
+
+    vtt << "WEBVTT\n";
+    for (const auto& cue : cues_) {
+        vtt << "\n"
+            << formatVttTime(cue.start) << " --> " << formatVttTime(cue.end) << "\n"
+            << imageFilename(filename_, cue.sheet, image_options_.format) << "#xywh=" << cue.x << "," << cue.y << "," << params_.tile_width << "," << tile_height_ << "\n";
+    }
+    hlm_info("Storyboard index with {} cues saved to: {}", cues_.size(), vtt_path);
+    return true;
+}
\ No newline at end of file
@@ -2,29 +2,98 @@
 #define HLM_SCREENSHOT_EXECUTOR_H
 
 #include <chrono>
+#include <deque>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "hlm_decoder.h"
 #include "hlm_encoder.h"
 #include "hlm_executor.h"
+#include "hlm_frame_analysis.h"
+#include "hlm_screenshot_archive.h"
 
 using namespace std;
 
+// 同步返回给 HTTP 调用方的图片，持有编码输出数据的引用，不写文件
+struct HlmInlineImage {
+    AVBufferRef* buffer = nullptr;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// 最清晰帧选择时的一个候选帧
+struct HlmFrameCandidate {
+    AVFrame* frame = nullptr;
+    double time = 0;
+    double sharpness = 0;
+};
+
+// 最清晰帧选择窗口取该值时，候选范围为目标所在的整个 GOP
+static const int HLM_SHARPEST_WINDOW_GOP = -1;
+
 // 通用的 ScreenshotExecutor 基类
 class HlmScreenshotExecutor : public HlmExecutor {
    public:
     HlmScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const string& screenshot_method);
-    virtual ~HlmScreenshotExecutor() = default;
+    virtual ~HlmScreenshotExecutor();
 
     bool init() override;
     bool initOutputFile() override;
     void execute() override;
+    void checkAndSavePacket(AVPacket* encoded_packet, int stream_index) override;
     void processFrames(AVFrame* frame, int stream_index);
+    void setParallelRanges(int parallel_ranges);
+    void setImageOptions(const HlmImageOptions& image_options);
+    void setArchiveOutput(bool archive_output);
+    void setDedupDistance(int dedup_distance);
+    void setSharpestWindow(int sharpest_window);
+    void setInlineOutput(bool inline_output);
+    void setCacheKeyBase(const string& cache_key_base);
+    // 取出同步截图的结果，调用方负责释放 buffer
+    bool takeInlineImage(HlmInlineImage& image);
+    static string imageFilename(const string& filename_prefix, int index, const string& image_format, int width = 0);
+    static string metadataFilename(const string& filename_prefix);
 
    protected:
-    bool initEncoder();
+    // 根据解码帧的时间判断是否截图，只有需要保存的帧才做缩放和图片编码
+    virtual bool shouldCapture(double frame_time) = 0;
+    // 需要根据画面内容判断是否截图的方法重写此函数，默认只按时间判断
+    virtual bool shouldCaptureFrame(AVFrame* frame, double frame_time) { return shouldCapture(frame_time); }
+    // 截图保存后更新状态
+    virtual void onCaptured(double frame_time) {}
+    // 文件按目标时间点截图的方法返回排好序的目标时间点，执行时 seek 到目标前的关键帧再向后解码
+    virtual vector<double> computeCaptureTargets() { return {}; }
+
+    virtual void captureFrame(AVFrame* frame, double frame_time);
+    bool captureRendition(HlmEncoder* encoder, AVFrame* frame, double frame_time);
+    HlmEncoder* renditionEncoder(size_t rendition) const;
+    double getFrameTime(AVFrame* frame) const;
+    bool seekTo(double target_time);
+    void captureTargets();
+    void captureTargetsInParallel(int ranges);
+    bool reachedNextTarget(double frame_time) const;
+    bool advanceTargets(double frame_time);
+    size_t lastReachedTarget(double frame_time) const;
+    void saveFrame(AVFrame* frame, double frame_time);
+    bool isDuplicateFrame(AVFrame* frame, double frame_time);
+    void addPrecedingCandidate(AVFrame* frame, double frame_time);
+    void beginSelection(AVFrame* frame, double frame_time);
+    bool continueSelection(AVFrame* frame, double frame_time);
+    void finishSelection();
+    void clearCandidates();
+    void writeMetadata(int index, double frame_time);
+
+    bool needsDecodedVideo() const override { return true; }
+    bool keyframesOnly() const override { return keyframes_only_; }
+    bool needsAudioDecoder() const override { return false; }
+    bool usesInputPool() const override { return true; }
+    const ProbeSettings& probeSettings() const override { return CONF.getScreenshotProbe(); }
+    // 同步返回图片的请求在 HTTP 线程中等待截图完成
+    bool lowLatency() const override { return inline_output_; }
+    virtual bool initEncoder();
+    virtual bool initImageScaler();
     void savePacketAsImage(AVPacket* encoded_packet);
     void flushDecoder();
     void flushEncoder();
@@ -32,45 +101,178 @@ class HlmScreenshotExecutor : public HlmExecutor {
    protected:
     string screenshot_method_;
     int frame_count_ = 0;
+    bool keyframes_only_ = false;
+    vector<double> capture_targets_;
+    size_t next_target_ = 0;
+    int target_index_offset_ = 0;  // 第一个目标对应的输出文件序号
+    int parallel_ranges_ = 1;
+    HlmImageOptions image_options_;
+    vector<int> rendition_widths_;                      // 每种输出尺寸的宽度，0 表示原始分辨率
+    vector<unique_ptr<HlmEncoder>> rendition_encoders_;  // 第二种及之后尺寸的编码器，第一种使用 video_encoder_
+    int rendition_width_ = 0;                           // 当前保存的输出尺寸
+    double capture_time_ = 0;                           // 当前保存的截图对应的媒体时间
+    bool archive_output_ = false;                       // 图片追加写入归档而不是逐张写文件
+    unique_ptr<HlmScreenshotArchive> archive_;
+    bool inline_output_ = false;                // 图片保留在内存中由 HTTP 响应返回，不写文件
+    string cache_key_base_;                     // 非空时按目标截图的结果写入截图结果缓存
+    HlmInlineImage inline_image_;
+    int dedup_distance_ = -1;                   // 与上一张截图的哈希距离不超过该值时跳过，小于 0 不去重
+    unique_ptr<HlmLumaSampler> hash_sampler_;
+    vector<uint8_t> hash_luma_;
+    uint64_t frame_hash_ = 0;                   // 当前候选帧的感知哈希
+    uint64_t last_saved_hash_ = 0;
+    bool has_saved_hash_ = false;
+    shared_ptr<HlmWriteFile> metadata_file_;   // 每张截图一行 JSON，记录序号、时间和感知哈希
+    int64_t metadata_size_ = 0;
+    int sharpest_window_ = 0;                   // 目标前后各取多少帧选最清晰的一帧，0 不选择，HLM_SHARPEST_WINDOW_GOP 取整个 GOP
+    HlmSharpnessMeter sharpness_meter_;
+    deque<HlmFrameCandidate> preceding_candidates_;  // 目标之前最近的候选帧
+    HlmFrameCandidate best_candidate_;               // 正在选择的目标当前最清晰的帧
+    bool selecting_ = false;
+    int selection_remaining_ = 0;                    // 目标之后还需评估的帧数
+
+    static constexpr double SEEK_MIN_DISTANCE = 3.0;  // 下一个目标距当前解码位置超过3秒时才 seek，否则继续向后解码
+    static const size_t MIN_TARGETS_PER_RANGE = 2;    // 并行拆分时每个区间至少包含的目标数
 };
 
 // 按时间间隔截图
 class HlmIntervalScreenshotExecutor : public HlmScreenshotExecutor {
    public:
-    HlmIntervalScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int interval, const string& screenshot_method);
-    void checkAndSavePacket(AVPacket* encoded_packet,int stream_index) override;
+    HlmIntervalScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int interval, bool keyframes_only, const string& screenshot_method);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
 
    private:
     int interval_;
-    int64_t last_saved_timestamp_ = 0;
+    double last_saved_timestamp_ = 0;
 };
 
 // 按百分比截图
 class HlmPercentageScreenshotExecutor : public HlmScreenshotExecutor {
    public:
     HlmPercentageScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int percentage, const string& screenshot_method);
-    void checkAndSavePacket(AVPacket* encoded_packet,int stream_index) override;
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
+
+    vector<double> computeCaptureTargets() override;
 
    private:
     int percentage_;
-    double last_saved_percentage_;
 };
 
 // 立即截图
 class HlmImmediateScreenshotExecutor : public HlmScreenshotExecutor {
    public:
-    HlmImmediateScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const string& screenshot_method);
-    void checkAndSavePacket(AVPacket* encoded_packet,int stream_index) override;
+    HlmImmediateScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, bool keyframes_only, const string& screenshot_method);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
+    bool replaysGopCache() const override { return true; }
+    bool lowLatency() const override { return true; }
 };
 
 // 指定时间点截图
 class HlmSpecificTimeScreenshotExecutor : public HlmScreenshotExecutor {
    public:
-    HlmSpecificTimeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, int time_second, const string& screenshot_method);
-    void checkAndSavePacket(AVPacket* encoded_packet,int stream_index) override;
+    HlmSpecificTimeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const vector<int>& time_seconds, const string& screenshot_method);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
+
+    vector<double> computeCaptureTargets() override;
+
+   private:
+    vector<int> time_seconds_;
+};
+
+// 截取一段目标时间点，文件截图按时间区间拆分后由各区间独立打开输入并解码
+class HlmRangeScreenshotExecutor : public HlmScreenshotExecutor {
+   public:
+    HlmRangeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const vector<double>& targets, int first_index, const string& screenshot_method);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
+    vector<double> computeCaptureTargets() override;
+
+   private:
+    vector<double> targets_;
+};
+
+// 场景变化截图：缩小后的亮度平面与上一张截图相比变化超过阈值时截图
+class HlmSceneChangeScreenshotExecutor : public HlmScreenshotExecutor {
+   public:
+    HlmSceneChangeScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, double threshold, double min_interval, const string& screenshot_method);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    bool shouldCaptureFrame(AVFrame* frame, double frame_time) override;
+    void onCaptured(double frame_time) override;
 
    private:
-    int time_second_;
+    double threshold_;     // 亮度平均绝对差阈值，取值 0-255
+    double min_interval_;  // 两次截图的最小间隔，单位：秒
+    double last_saved_timestamp_ = -1;
+    HlmLumaSampler luma_sampler_;
+    vector<uint8_t> current_luma_;
+    vector<uint8_t> reference_luma_;
+
+    static const int SAMPLE_WIDTH = 64;   // 场景检测的亮度平面宽度
+    static const int SAMPLE_HEIGHT = 36;  // 场景检测的亮度平面高度
+};
+
+// 雪碧图参数
+struct HlmStoryboardParams {
+    int interval = 10;     // 缩略图间隔，单位：秒
+    int tile_width = 160;  // 缩略图宽度，高度按原始宽高比计算
+    int columns = 10;      // 每张雪碧图的列数
+    int rows = 10;         // 每张雪碧图的行数
+};
+
+// 雪碧图截图：按间隔截取缩略图拼接成固定网格的雪碧图，并生成 WebVTT 索引
+class HlmStoryboardScreenshotExecutor : public HlmScreenshotExecutor {
+   public:
+    HlmStoryboardScreenshotExecutor(const string& stream_url, const string& output_dir, const string& filename_prefix, const HlmStoryboardParams& params, const string& screenshot_method);
+    ~HlmStoryboardScreenshotExecutor();
+
+    void execute() override;
+    static string vttFilename(const string& filename_prefix);
+
+   protected:
+    bool shouldCapture(double frame_time) override;
+    void onCaptured(double frame_time) override;
+    vector<double> computeCaptureTargets() override;
+    void captureFrame(AVFrame* frame, double frame_time) override;
+    bool initEncoder() override;
+    bool initImageScaler() override;
+
+   private:
+    void placeTile(AVFrame* frame, int tile_index);
+    void saveSheet();
+    bool writeVtt();
+
+    // 一张缩略图在雪碧图中的位置
+    struct HlmStoryboardCue {
+        double start;
+        double end;
+        int sheet;
+        int x;
+        int y;
+    };
+
+    HlmStoryboardParams params_;
+    int tile_height_ = 0;
+    SwsContext* tile_sws_ctx_ = nullptr;
+    AVFrame* sheet_frame_ = nullptr;
+    int sheet_index_ = 0;
+    int sheet_tiles_ = 0;
+    vector<HlmStoryboardCue> cues_;
 };
 
 #endif  // HLM_SCREENSHOT_EXECUTOR_H
@@ -1,12 +1,112 @@
 #include "hlm_screenshot_strategy.h"
 #include "hlm_screenshot_task.h"
+#include "utils/hlm_config.h"
+
+// 解析输出方式：files 每张截图一个文件，archive 追加写入归档，inline 由 HTTP 响应同步返回单张图片
+static bool parseArchiveOutput(const json::rvalue& body, bool allow_inline = false) {
+    if (!body.has("output_mode")) {
+        return false;
+    }
+    string output_mode = body["output_mode"].s();
+    if (output_mode == "inline" && !allow_inline) {
+        throw invalid_argument("output_mode inline is only supported for immediate and specific_time screenshots.");
+    }
+    if (output_mode != "files" && output_mode != "archive" && output_mode != "inline") {
+        throw invalid_argument("output_mode must be files, archive or inline.");
+    }
+    return output_mode == "archive";
+}
+
+static bool parseInlineOutput(const json::rvalue& body, const HlmImageOptions& options) {
+    if (!body.has("output_mode") || body["output_mode"].s() != "inline") {
+        return false;
+    }
+    if (options.widths.size() > 1) {
+        throw invalid_argument("output_mode inline returns a single image, widths must have at most one entry.");
+    }
+    return true;
+}
+
+// 解析去重距离：指定 dedup_distance 时跳过与上一张截图感知哈希距离不超过该值的帧，未指定时不去重
+static int parseDedupDistance(const json::rvalue& body) {
+    if (!body.has("dedup_distance")) {
+        return -1;
+    }
+    int dedup_distance = body["dedup_distance"].i();
+    if (dedup_distance < 0 || dedup_distance > 64) {
+        throw invalid_argument("dedup_distance must be between 0 and 64.");
+    }
+    return dedup_distance;
+}
+
+static const int MAX_SHARPEST_WINDOW = 30;  // 最清晰帧选择目标前后最多各评估的帧数
+
+// 解析最清晰帧选择窗口：整数表示目标前后各评估的帧数，gop 表示评估目标所在的整个 GOP，未指定时不选择
+static int parseSharpestWindow(const json::rvalue& body) {
+    if (!body.has("sharpest_window")) {
+        return 0;
+    }
+    if (body["sharpest_window"].t() == json::type::String) {
+        if (body["sharpest_window"].s() != "gop") {
+            throw invalid_argument("sharpest_window must be a frame count or gop.");
+        }
+        return HLM_SHARPEST_WINDOW_GOP;
+    }
+    int sharpest_window = body["sharpest_window"].i();
+    if (sharpest_window < 0 || sharpest_window > MAX_SHARPEST_WINDOW) {
+        throw invalid_argument("sharpest_window must be between 0 and " + to_string(MAX_SHARPEST_WINDOW) + ".");
+    }
+    return sharpest_window;
+}
+
+static const int MAX_STORYBOARD_WIDTH = 16384;        // 雪碧图最大宽度
+static const double DEFAULT_SCENE_THRESHOLD = 12.0;   // 场景变化默认阈值，亮度平均绝对差
+static const double DEFAULT_SCENE_MIN_INTERVAL = 2.0;  // 场景变化截图默认最小间隔，单位：秒
+
+// 解析截图输出格式和质量，未指定时使用配置中的默认值
+static HlmImageOptions parseImageOptions(const json::rvalue& body) {
+    HlmImageOptions options;
+    options.format = body.has("image_format") ? string(body["image_format"].s()) : CONF.getImageFormat();
+    options.quality = body.has("quality") ? static_cast<int>(body["quality"].i()) : CONF.getImageQuality();
+
+    if (options.format != HlmImageFormat::Png && options.format != HlmImageFormat::Jpeg && options.format != HlmImageFormat::Webp) {
+        throw invalid_argument("image_format must be png, jpeg or webp.");
+    }
+    if (options.quality < 1 || options.quality > 100) {
+        throw invalid_argument("quality must be between 1 and 100.");
+    }
+    // widths 指定多个输出宽度时，同一帧缩放成多种尺寸
+    if (body.has("widths")) {
+        if (body["widths"].t() != json::type::List) {
+            throw invalid_argument("widths must be a list.");
+        }
+        for (const auto& width : body["widths"]) {
+            if (width.i() <= 0) {
+                throw invalid_argument("widths must be positive.");
+            }
+            if (find(options.widths.begin(), options.widths.end(), width.i()) != options.widths.end()) {
+                throw invalid_argument("widths must not contain duplicates.");
+            }
+            options.widths.push_back(static_cast<int>(width.i()));
+        }
+    }
+    if (!HlmEncoder::findImageEncoder(options.format)) {
+        throw invalid_argument("image_format " + options.format + " is not supported by this build.");
+    }
+    return options;
+}
 
 shared_ptr<HlmTask> HlmIntervalScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
     int interval = body["interval"].i();
     if (interval <= 0) {
         throw invalid_argument("Interval must be positive.");
     }
-    return make_shared<HlmIntervalScreenshotTask>(stream_url, method, output_dir, filename_prefix, interval);
+    bool keyframes_only = body.has("keyframes_only") && body["keyframes_only"].b();
+    auto task = make_shared<HlmIntervalScreenshotTask>(stream_url, method, output_dir, filename_prefix, interval, keyframes_only);
+    task->setImageOptions(parseImageOptions(body));
+    task->setArchiveOutput(parseArchiveOutput(body));
+    task->setDedupDistance(parseDedupDistance(body));
+    return task;
 }
 
 shared_ptr<HlmTask> HlmPercentageScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
@@ -14,19 +114,103 @@ shared_ptr<HlmTask> HlmPercentageScreenshotStrategy::createTask(const string& st
     if (percentage <= 0 || percentage > 100) {
         throw invalid_argument("Percentage must be between 1 and 100.");
     }
-    return make_shared<HlmPercentageScreenshotTask>(stream_url, method, output_dir, filename_prefix, percentage);
+    auto task = make_shared<HlmPercentageScreenshotTask>(stream_url, method, output_dir, filename_prefix, percentage);
+    task->setMaxParallelRanges(body.has("max_parallel") ? body["max_parallel"].i() : CONF.getMaxParallelRanges());
+    task->setImageOptions(parseImageOptions(body));
+    task->setArchiveOutput(parseArchiveOutput(body));
+    task->setDedupDistance(parseDedupDistance(body));
+    task->setSharpestWindow(parseSharpestWindow(body));
+    return task;
 }
 
 shared_ptr<HlmTask> HlmImmediateScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
-    return make_shared<HlmImmediateScreenshotTask>(stream_url, method, output_dir, filename_prefix);
+    bool keyframes_only = body.has("keyframes_only") && body["keyframes_only"].b();
+    auto task = make_shared<HlmImmediateScreenshotTask>(stream_url, method, output_dir, filename_prefix, keyframes_only);
+    HlmImageOptions image_options = parseImageOptions(body);
+    task->setImageOptions(image_options);
+    task->setArchiveOutput(parseArchiveOutput(body, true));
+    task->setInlineOutput(parseInlineOutput(body, image_options));
+    return task;
 }
 
 shared_ptr<HlmTask> HlmSpecificTimeScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
-    int timeSecond = body["time_second"].i();
-    if (timeSecond < 0) {
-        throw invalid_argument("time_second must be non-negative.");
+    // time_second 可以是单个时间点，也可以是升序排列的时间点列表
+    vector<int> time_seconds;
+    if (body["time_second"].t() == json::type::List) {
+        for (const auto& time_second : body["time_second"]) {
+            time_seconds.push_back(time_second.i());
+        }
+    } else {
+        time_seconds.push_back(body["time_second"].i());
+    }
+
+    if (time_seconds.empty()) {
+        throw invalid_argument("time_second must not be empty.");
+    }
+    for (size_t i = 0; i < time_seconds.size(); ++i) {
+        if (time_seconds[i] < 0) {
+            throw invalid_argument("time_second must be non-negative.");
+        }
+        if (i > 0 && time_seconds[i] <= time_seconds[i - 1]) {
+            throw invalid_argument("time_second must be sorted in ascending order without duplicates.");
+        }
+    }
+    auto task = make_shared<HlmSpecificTimeScreenshotTask>(stream_url, method, output_dir, filename_prefix, time_seconds);
+    task->setMaxParallelRanges(body.has("max_parallel") ? body["max_parallel"].i() : CONF.getMaxParallelRanges());
+    HlmImageOptions image_options = parseImageOptions(body);
+    task->setImageOptions(image_options);
+    task->setArchiveOutput(parseArchiveOutput(body, true));
+    task->setInlineOutput(parseInlineOutput(body, image_options));
+    if (task->isInlineOutput() && time_seconds.size() > 1) {
+        throw invalid_argument("output_mode inline returns a single image, time_second must be a single time point.");
+    }
+    task->setDedupDistance(parseDedupDistance(body));
+    task->setSharpestWindow(parseSharpestWindow(body));
+    return task;
+}
+
+shared_ptr<HlmTask> HlmSceneChangeScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
+    double threshold = body.has("threshold") ? body["threshold"].d() : DEFAULT_SCENE_THRESHOLD;
+    double min_interval = body.has("min_interval") ? body["min_interval"].d() : DEFAULT_SCENE_MIN_INTERVAL;
+    if (threshold <= 0 || threshold > 255) {
+        throw invalid_argument("threshold must be between 0 and 255.");
     }
-    return make_shared<HlmSpecificTimeScreenshotTask>(stream_url, method, output_dir, filename_prefix, timeSecond);
+    if (min_interval < 0) {
+        throw invalid_argument("min_interval must be non-negative.");
+    }
+
+    auto task = make_shared<HlmSceneChangeScreenshotTask>(stream_url, method, output_dir, filename_prefix, threshold, min_interval);
+    task->setImageOptions(parseImageOptions(body));
+    task->setArchiveOutput(parseArchiveOutput(body));
+    task->setDedupDistance(parseDedupDistance(body));
+    return task;
+}
+
+shared_ptr<HlmTask> HlmStoryboardScreenshotStrategy::createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) {
+    HlmStoryboardParams params;
+    params.interval = body.has("interval") ? body["interval"].i() : params.interval;
+    params.tile_width = body.has("tile_width") ? body["tile_width"].i() : params.tile_width;
+    params.columns = body.has("columns") ? body["columns"].i() : params.columns;
+    params.rows = body.has("rows") ? body["rows"].i() : params.rows;
+
+    if (params.interval <= 0) {
+        throw invalid_argument("Interval must be positive.");
+    }
+    if (params.tile_width < 16) {
+        throw invalid_argument("tile_width must be at least 16.");
+    }
+    if (params.columns <= 0 || params.rows <= 0) {
+        throw invalid_argument("columns and rows must be positive.");
+    }
+    // 缩略图宽度取偶数，保证 YUV420 色度平面按格对齐
+    params.tile_width &= ~1;
+    if (params.tile_width * params.columns > MAX_STORYBOARD_WIDTH) {
+        throw invalid_argument("tile_width * columns must not exceed " + to_string(MAX_STORYBOARD_WIDTH) + ".");
+    }
+
+    auto task = make_shared<HlmStoryboardScreenshotTask>(stream_url, method, output_dir, filename_prefix, params);
+    task->setImageOptions(parseImageOptions(body));
+    return task;
 }
 
 shared_ptr<HlmScreenshotStrategy> HlmScreenshotStrategyFactory::createStrategy(const string& method) {
@@ -38,6 +222,10 @@ shared_ptr<HlmScreenshotStrategy> HlmScreenshotStrategyFactory::createStrategy(c
         return make_shared<HlmImmediateScreenshotStrategy>();
     } else if (method == HlmScreenshotMethod::SpecificTime) {
         return make_shared<HlmSpecificTimeScreenshotStrategy>();
+    } else if (method == HlmScreenshotMethod::SceneChange) {
+        return make_shared<HlmSceneChangeScreenshotStrategy>();
+    } else if (method == HlmScreenshotMethod::Storyboard) {
+        return make_shared<HlmStoryboardScreenshotStrategy>();
     } else {
         throw invalid_argument("Invalid screenshot method.");
     }
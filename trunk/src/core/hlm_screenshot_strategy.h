@@ -41,6 +41,18 @@ class HlmSpecificTimeScreenshotStrategy : public HlmScreenshotStrategy {
     shared_ptr<HlmTask> createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) override;
 };
 
+// 场景变化截图策略
+class HlmSceneChangeScreenshotStrategy : public HlmScreenshotStrategy {
+   public:
+    shared_ptr<HlmTask> createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) override;
+};
+
+// 雪碧图截图策略
+class HlmStoryboardScreenshotStrategy : public HlmScreenshotStrategy {
+   public:
+    shared_ptr<HlmTask> createTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const json::rvalue& body) override;
+};
+
 // 使用工厂创建策略
 class HlmScreenshotStrategyFactory {
    public:
@@ -1,5 +1,7 @@
 #include "hlm_screenshot_task.h"
 
+#include "hlm_screenshot_cache.h"
+#include "utils/hlm_config.h"
 #include "utils/hlm_logger.h"
 
 HlmScreenshotTask::HlmScreenshotTask(const string& stream_url, const string& method)
@@ -8,6 +10,14 @@ HlmScreenshotTask::HlmScreenshotTask(const string& stream_url, const string& met
 void HlmScreenshotTask::execute() {
     if (!executor_) {
         executor_ = createExecutor();
+        executor_->setParallelRanges(parallelRanges());
+        executor_->setImageOptions(image_options_);
+        executor_->setArchiveOutput(archive_output_);
+        executor_->setDedupDistance(dedup_distance_);
+        executor_->setSharpestWindow(sharpest_window_);
+        executor_->setInlineOutput(inline_output_);
+        executor_->setDecoderThreading(decoder_threading_);
+        executor_->setCacheKeyBase(cacheKeyBase());
     }
     executor_->execute();
 }
@@ -18,12 +28,70 @@ void HlmScreenshotTask::stop() {
     }
 }
 
-HlmIntervalScreenshotTask::HlmIntervalScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int interval)
+HlmTaskCost HlmScreenshotTask::estimateCost() const {
+    HlmTaskCost range_cost = HlmTaskCostModel::decodeCost(media_profile_, decodeIntensity());
+    int ranges = parallelRanges();
+    return {range_cost.cpu * ranges, range_cost.memory_mb * ranges};
+}
+
+void HlmScreenshotTask::setMaxParallelRanges(int max_parallel_ranges) {
+    max_parallel_ranges_ = max(1, max_parallel_ranges);
+}
+
+void HlmScreenshotTask::setImageOptions(const HlmImageOptions& image_options) {
+    image_options_ = image_options;
+}
+
+void HlmScreenshotTask::setArchiveOutput(bool archive_output) {
+    archive_output_ = archive_output;
+}
+
+void HlmScreenshotTask::setDedupDistance(int dedup_distance) {
+    dedup_distance_ = dedup_distance;
+}
+
+void HlmScreenshotTask::setSharpestWindow(int sharpest_window) {
+    sharpest_window_ = sharpest_window;
+}
+
+void HlmScreenshotTask::setInlineOutput(bool inline_output) {
+    inline_output_ = inline_output;
+}
+
+bool HlmScreenshotTask::takeInlineImage(HlmInlineImage& image) {
+    return executor_ && executor_->takeInlineImage(image);
+}
+
+double HlmScreenshotTask::decodeIntensity() const {
+    // 实时流按实时速率解码；文件不受实时速率限制，解码会尽可能占满解码线程
+    double intensity = isLiveStream() ? 1.0 : 2.0;
+    if (getMethod() == HlmScreenshotMethod::Immediate) {
+        intensity = 0.5;
+    }
+    if (keyframes_only_) {
+        intensity *= 0.1;
+    }
+    return intensity;
+}
+
+int HlmScreenshotTask::parallelRanges() const {
+    if (isLiveStream() || max_parallel_ranges_ <= 1) {
+        return 1;
+    }
+
+    // 每个区间独立解码，区间数受 CPU 预算限制
+    double range_cpu = HlmTaskCostModel::decodeCost(media_profile_, decodeIntensity()).cpu;
+    int budget_ranges = max(1, static_cast<int>(CONF.getCpuBudget() / range_cpu));
+    return min(max_parallel_ranges_, budget_ranges);
+}
+
+HlmIntervalScreenshotTask::HlmIntervalScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int interval, bool keyframes_only)
     : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix), interval_(interval) {
+    keyframes_only_ = keyframes_only;
 }
 
 unique_ptr<HlmScreenshotExecutor> HlmIntervalScreenshotTask::createExecutor() {
-    return make_unique<HlmIntervalScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, interval_, HlmScreenshotMethod::Interval);
+    return make_unique<HlmIntervalScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, interval_, keyframes_only_, HlmScreenshotMethod::Interval);
 }
 
 HlmPercentageScreenshotTask::HlmPercentageScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int percentage)
@@ -34,18 +102,82 @@ unique_ptr<HlmScreenshotExecutor> HlmPercentageScreenshotTask::createExecutor()
     return make_unique<HlmPercentageScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, percentage_, HlmScreenshotMethod::Percentage);
 }
 
-HlmImmediateScreenshotTask::HlmImmediateScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix)
+HlmImmediateScreenshotTask::HlmImmediateScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, bool keyframes_only)
     : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix) {
+    keyframes_only_ = keyframes_only;
 }
 
 unique_ptr<HlmScreenshotExecutor> HlmImmediateScreenshotTask::createExecutor() {
-    return make_unique<HlmImmediateScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, HlmScreenshotMethod::Immediate);
+    return make_unique<HlmImmediateScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, keyframes_only_, HlmScreenshotMethod::Immediate);
+}
+
+HlmSpecificTimeScreenshotTask::HlmSpecificTimeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const vector<int>& time_seconds)
+    : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix), time_seconds_(time_seconds) {
+}
+
+vector<string> HlmSpecificTimeScreenshotTask::outputFiles() const {
+    vector<string> files;
+    // 归档输出的图片通过归档读取接口按序号获取
+    if (archive_output_) {
+        return files;
+    }
+    vector<int> widths = image_options_.widths.empty() ? vector<int>{0} : image_options_.widths;
+    for (size_t i = 0; i < time_seconds_.size(); ++i) {
+        for (int width : widths) {
+            files.push_back(output_dir_ + "/" + HlmScreenshotExecutor::imageFilename(filename_prefix_, static_cast<int>(i), image_options_.format, width));
+        }
+    }
+    return files;
 }
 
-HlmSpecificTimeScreenshotTask::HlmSpecificTimeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int time_second)
-    : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix), time_second_(time_second) {
+string HlmSpecificTimeScreenshotTask::cacheKeyBase() const {
+    // 去重会跳过部分时间点，归档输出按序号读取，这两种情况不使用缓存
+    if (!HlmScreenshotCache::getInstance().isEnabled() || archive_output_ || dedup_distance_ >= 0) {
+        return "";
+    }
+    string file_key = HlmScreenshotCache::fileKey(getStreamUrl());
+    if (file_key.empty()) {
+        return "";
+    }
+    return file_key + "|" + image_options_.format + "|q=" + to_string(image_options_.quality) + "|sharpest=" + to_string(sharpest_window_);
+}
+
+vector<string> HlmSpecificTimeScreenshotTask::cacheKeys() const {
+    vector<string> keys;
+    string key_base = cacheKeyBase();
+    if (key_base.empty()) {
+        return keys;
+    }
+    vector<int> widths = image_options_.widths.empty() ? vector<int>{0} : image_options_.widths;
+    for (int time_second : time_seconds_) {
+        for (int width : widths) {
+            keys.push_back(HlmScreenshotCache::imageKey(key_base, time_second, width));
+        }
+    }
+    return keys;
 }
 
 unique_ptr<HlmScreenshotExecutor> HlmSpecificTimeScreenshotTask::createExecutor() {
-    return make_unique<HlmSpecificTimeScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, time_second_, HlmScreenshotMethod::SpecificTime);
+    return make_unique<HlmSpecificTimeScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, time_seconds_, HlmScreenshotMethod::SpecificTime);
+}
+
+HlmSceneChangeScreenshotTask::HlmSceneChangeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, double threshold, double min_interval)
+    : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix), threshold_(threshold), min_interval_(min_interval) {
+}
+
+unique_ptr<HlmScreenshotExecutor> HlmSceneChangeScreenshotTask::createExecutor() {
+    return make_unique<HlmSceneChangeScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, threshold_, min_interval_, HlmScreenshotMethod::SceneChange);
+}
+
+HlmStoryboardScreenshotTask::HlmStoryboardScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const HlmStoryboardParams& params)
+    : HlmScreenshotTask(stream_url, method), output_dir_(output_dir), filename_prefix_(filename_prefix), params_(params) {
+}
+
+vector<string> HlmStoryboardScreenshotTask::outputFiles() const {
+    // 雪碧图张数取决于视频时长，响应中只返回索引文件
+    return {output_dir_ + "/" + HlmStoryboardScreenshotExecutor::vttFilename(filename_prefix_)};
+}
+
+unique_ptr<HlmScreenshotExecutor> HlmStoryboardScreenshotTask::createExecutor() {
+    return make_unique<HlmStoryboardScreenshotExecutor>(getStreamUrl(), output_dir_, filename_prefix_, params_, HlmScreenshotMethod::Storyboard);
 }
\ No newline at end of file
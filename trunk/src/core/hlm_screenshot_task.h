@@ -5,6 +5,7 @@
 #include "hlm_screenshot_executor.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 // 处理截图任务的基类 HlmScreenshotTask
 class HlmScreenshotTask : public HlmTask {
@@ -13,17 +14,39 @@ class HlmScreenshotTask : public HlmTask {
 
     void execute() override;
     void stop() override;
+    HlmTaskCost estimateCost() const override;
+    void setMaxParallelRanges(int max_parallel_ranges);
+    void setImageOptions(const HlmImageOptions& image_options);
+    void setArchiveOutput(bool archive_output);
+    void setDedupDistance(int dedup_distance);
+    void setSharpestWindow(int sharpest_window);
+    void setInlineOutput(bool inline_output);
+    bool isInlineOutput() const { return inline_output_; }
+    bool takeInlineImage(HlmInlineImage& image);
+    virtual vector<string> outputFiles() const { return {}; }
+    // 结果可以缓存的截图方式返回每张输出图片的缓存 key，顺序与 outputFiles 一致
+    virtual vector<string> cacheKeys() const { return {}; }
 
    protected:
     virtual unique_ptr<HlmScreenshotExecutor> createExecutor() = 0;
+    virtual string cacheKeyBase() const { return ""; }
+    double decodeIntensity() const;
+    int parallelRanges() const;
 
     unique_ptr<HlmScreenshotExecutor> executor_;
+    bool keyframes_only_ = false;
+    int max_parallel_ranges_ = 1;
+    HlmImageOptions image_options_;
+    bool archive_output_ = false;
+    int dedup_distance_ = -1;
+    int sharpest_window_ = 0;
+    bool inline_output_ = false;
 };
 
 // 按时间间隔截图
 class HlmIntervalScreenshotTask : public HlmScreenshotTask {
    public:
-    HlmIntervalScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int interval);
+    HlmIntervalScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int interval, bool keyframes_only);
 
    protected:
     unique_ptr<HlmScreenshotExecutor> createExecutor() override;
@@ -51,7 +74,7 @@ class HlmPercentageScreenshotTask : public HlmScreenshotTask {
 // 立即截图
 class HlmImmediateScreenshotTask : public HlmScreenshotTask {
    public:
-    HlmImmediateScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix);
+    HlmImmediateScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, bool keyframes_only);
 
    protected:
     unique_ptr<HlmScreenshotExecutor> createExecutor() override;
@@ -64,7 +87,42 @@ class HlmImmediateScreenshotTask : public HlmScreenshotTask {
 // 指定时间点截图
 class HlmSpecificTimeScreenshotTask : public HlmScreenshotTask {
    public:
-    HlmSpecificTimeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, int time_second);
+    HlmSpecificTimeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const vector<int>& time_seconds);
+
+    vector<string> outputFiles() const override;
+    vector<string> cacheKeys() const override;
+
+   protected:
+    unique_ptr<HlmScreenshotExecutor> createExecutor() override;
+    string cacheKeyBase() const override;
+
+   private:
+    string output_dir_;
+    string filename_prefix_;
+    vector<int> time_seconds_;
+};
+
+// 场景变化截图
+class HlmSceneChangeScreenshotTask : public HlmScreenshotTask {
+   public:
+    HlmSceneChangeScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, double threshold, double min_interval);
+
+   protected:
+    unique_ptr<HlmScreenshotExecutor> createExecutor() override;
+
+   private:
+    string output_dir_;
+    string filename_prefix_;
+    double threshold_;
+    double min_interval_;
+};
+
+// 雪碧图截图
+class HlmStoryboardScreenshotTask : public HlmScreenshotTask {
+   public:
+    HlmStoryboardScreenshotTask(const string& stream_url, const string& method, const string& output_dir, const string& filename_prefix, const HlmStoryboardParams& params);
+
+    vector<string> outputFiles() const override;
 
    protected:
     unique_ptr<HlmScreenshotExecutor> createExecutor() override;
@@ -72,7 +130,7 @@ class HlmSpecificTimeScreenshotTask : public HlmScreenshotTask {
    private:
     string output_dir_;
     string filename_prefix_;
-    int time_second_;
+    HlmStoryboardParams params_;
 };
 
 #endif  // HLM_SCREENSHOT_TASK_H
\ No newline at end of file
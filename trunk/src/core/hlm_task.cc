@@ -6,7 +6,7 @@
 #include "utils/hlm_logger.h"
 
 HlmTask::HlmTask(TaskType type, const string& stream_url, const string& method)
-    : type_(type), stream_url_(stream_url), method_(method) {}
+    : type_(type), stream_url_(stream_url), method_(method), cancelled_(false) {}
 
 HlmTask::TaskType HlmTask::getType() const { return type_; }
 
@@ -18,26 +18,59 @@ void HlmTask::setCancelled(bool cancelled) { cancelled_ = cancelled; }
 
 bool HlmTask::isCancelled() const { return cancelled_; }
 
-HlmTaskManager::HlmTaskManager(int maxConcurrentTasks) : max_tasks_(maxConcurrentTasks) {}
+void HlmTask::setMediaProfile(const HlmMediaProfile& profile) { media_profile_ = profile; }
+
+const HlmMediaProfile& HlmTask::getMediaProfile() const { return media_profile_; }
+
+void HlmTask::setDecoderThreading(const HlmDecoderThreading& threading) { decoder_threading_ = threading; }
+
+bool HlmTask::isLiveStream() const { return stream_url_.find("rtmp://") == 0; }
+
+HlmTaskManager::HlmTaskManager(const TaskConfig& config)
+    : max_tasks_(config.max_tasks), cpu_budget_(config.cpu_budget), memory_budget_mb_(config.memory_budget_mb), worker_pool_("task", config.worker_threads) {
+    if (cpu_budget_ <= 0) {
+        cpu_budget_ = max(1u, thread::hardware_concurrency());
+    }
+    if (config.worker_threads < max_tasks_) {
+        hlm_warn("Worker threads ({}) are fewer than max tasks ({}), started tasks may wait for a free worker.", config.worker_threads, max_tasks_);
+    }
+    hlm_info("Task admission budget: cpu: {} cores, memory: {}MB, max tasks: {}", cpu_budget_, memory_budget_mb_, max_tasks_);
+}
+
+HlmTaskManager::~HlmTaskManager() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto& task : active_tasks_) {
+            task->setCancelled(true);
+            stopTask(task);
+        }
+        active_tasks_.clear();
+        active_task_costs_.clear();
+        task_queue_.clear();
+        cpu_used_ = 0.0;
+        memory_used_mb_ = 0;
+    }
+    worker_pool_.shutdown();
+}
 
 HlmTaskAddStatus HlmTaskManager::addTask(shared_ptr<HlmTask> task, const string& stream_url, const string& method) {
     lock_guard<mutex> lock(mutex_);
     string task_key = createTaskKey(stream_url, method);
-    if (active_task_keys_.count(task_key) > 0) {
+    if (active_task_costs_.count(task_key) > 0) {
         return HlmTaskAddStatus::TaskAlreadyRunning;
     }
 
-    if (active_tasks_.size() >= max_tasks_) {
+    // 队列非空时新任务排在队尾，避免开销大的任务一直被后来的小任务插队
+    HlmTaskCost cost = task->estimateCost();
+    if (!task_queue_.empty() || !canAdmit(cost)) {
         task_queue_.push_back(task);
-        hlm_info("Task queued. Current active tasks: {}/{}. Queued tasks: {}", active_tasks_.size(), max_tasks_, task_queue_.size());
+        hlm_info("Task queued for stream_url: {}, method: {}, cost: {} cores/{}MB. CPU used: {}/{}, active tasks: {}/{}. Queued tasks: {}",
+                 stream_url, method, cost.cpu, cost.memory_mb, cpu_used_, cpu_budget_, active_tasks_.size(), max_tasks_, task_queue_.size());
         return HlmTaskAddStatus::TaskQueued;
-    } else {
-        active_tasks_.push_back(task);
-        active_task_keys_[task_key] = true;
-        hlm_info("Task started for stream_url: {}, method: {}. Active tasks: {}/{}", stream_url, method, active_tasks_.size(), max_tasks_);
-        executeTask(task, task_key);
-        return HlmTaskAddStatus::TaskStarted;
     }
+
+    startTask(task, task_key, cost);
+    return HlmTaskAddStatus::TaskStarted;
 }
 
 HlmTaskAddStatus HlmTaskManager::updateTask(const string& streamUrl, const string& method, const HlmMixTaskParams& params) {
@@ -67,11 +100,12 @@ bool HlmTaskManager::removeTask(const string& streamUrl, const string& method) {
     });
 
     if (it != active_tasks_.end()) {
-        stopTask(*it);
-        (*it)->setCancelled(true);
-        active_tasks_.erase(it);
-        active_task_keys_.erase(task_key);
+        auto task = *it;
+        stopTask(task);
+        task->setCancelled(true);
+        releaseTask(task, task_key);
         hlm_info("Task removed for stream_url: {}, method: {}. Active tasks: {}/{}", streamUrl, method, active_tasks_.size(), max_tasks_);
+        scheduleQueuedTasks();
         return true;
     }
 
@@ -82,6 +116,7 @@ bool HlmTaskManager::removeTask(const string& streamUrl, const string& method) {
     if (queue_it != task_queue_.end()) {
         task_queue_.erase(queue_it);
         hlm_info("Queued task removed for stream_url: {}, method: {}. Queued tasks: {}", streamUrl, method, task_queue_.size());
+        scheduleQueuedTasks();
         return true;
     }
 
@@ -98,27 +133,104 @@ void HlmTaskManager::taskCompleted(shared_ptr<HlmTask> task, const string& task_
     }
 
     stopTask(task);
+    releaseTask(task, task_key);
+    hlm_info("Task completed for key: {}. CPU used: {}/{}, active tasks: {}/{}", task_key, cpu_used_, cpu_budget_, active_tasks_.size(), max_tasks_);
+    scheduleQueuedTasks();
+}
+
+HlmThreadPoolStats HlmTaskManager::getWorkerStats() const {
+    return worker_pool_.getStats();
+}
+
+HlmTaskBudgetUsage HlmTaskManager::getBudgetUsage() const {
+    lock_guard<mutex> lock(mutex_);
+    HlmTaskBudgetUsage usage;
+    usage.cpu_used = cpu_used_;
+    usage.cpu_budget = cpu_budget_;
+    usage.memory_used_mb = memory_used_mb_;
+    usage.memory_budget_mb = memory_budget_mb_;
+    usage.active_tasks = active_tasks_.size();
+    usage.queued_tasks = task_queue_.size();
+    usage.max_tasks = max_tasks_;
+    return usage;
+}
+
+bool HlmTaskManager::canAdmit(const HlmTaskCost& cost) const {
+    if (max_tasks_ > 0 && active_tasks_.size() >= static_cast<size_t>(max_tasks_)) {
+        return false;
+    }
+
+    // 没有运行中的任务时总是放行，避免超出预算的单个任务永远无法执行
+    if (active_tasks_.empty()) {
+        return true;
+    }
+
+    if (cpu_used_ + cost.cpu > cpu_budget_) {
+        return false;
+    }
+
+    if (memory_budget_mb_ > 0 && memory_used_mb_ + cost.memory_mb > memory_budget_mb_) {
+        return false;
+    }
+    return true;
+}
+
+void HlmTaskManager::startTask(shared_ptr<HlmTask> task, const string& task_key, const HlmTaskCost& cost) {
+    active_tasks_.push_back(task);
+    active_task_costs_[task_key] = cost;
+    cpu_used_ += cost.cpu;
+    memory_used_mb_ += cost.memory_mb;
+    hlm_info("Task started for key: {}, cost: {} cores/{}MB. CPU used: {}/{}, memory used: {}MB, active tasks: {}/{}",
+             task_key, cost.cpu, cost.memory_mb, cpu_used_, cpu_budget_, memory_used_mb_, active_tasks_.size(), max_tasks_);
+    executeTask(task, task_key);
+}
+
+void HlmTaskManager::releaseTask(shared_ptr<HlmTask> task, const string& task_key) {
     active_tasks_.erase(remove(active_tasks_.begin(), active_tasks_.end(), task), active_tasks_.end());
-    active_task_keys_.erase(task_key);
-    hlm_info("Task completed for key: {}. Active tasks: {}/{}", task_key, active_tasks_.size(), max_tasks_);
 
-    if (!task_queue_.empty()) {
-        auto next_task = task_queue_.front();
-        task_queue_.pop_front();
+    auto it = active_task_costs_.find(task_key);
+    if (it != active_task_costs_.end()) {
+        cpu_used_ = max(0.0, cpu_used_ - it->second.cpu);
+        memory_used_mb_ = max<int64_t>(0, memory_used_mb_ - it->second.memory_mb);
+        active_task_costs_.erase(it);
+    }
+}
 
+void HlmTaskManager::scheduleQueuedTasks() {
+    while (!task_queue_.empty()) {
+        auto next_task = task_queue_.front();
         string next_task_key = createTaskKey(next_task->getStreamUrl(), next_task->getMethod());
-        active_tasks_.push_back(next_task);
-        active_task_keys_[next_task_key] = true;
-        hlm_info("Next task started for key: {}. Active tasks: {}/{}", next_task_key, active_tasks_.size(), max_tasks_);
-        executeTask(next_task, next_task_key);
+        if (active_task_costs_.count(next_task_key) > 0) {
+            hlm_warn("Dropping queued task for key: {}, the same task is already running.", next_task_key);
+            task_queue_.pop_front();
+            continue;
+        }
+
+        HlmTaskCost cost = next_task->estimateCost();
+        if (!canAdmit(cost)) {
+            break;
+        }
+
+        task_queue_.pop_front();
+        startTask(next_task, next_task_key, cost);
     }
 }
 
 void HlmTaskManager::executeTask(shared_ptr<HlmTask> task, const string& task_key) {
-    thread([this, task, task_key]() {
+    bool submitted = worker_pool_.submit([this, task, task_key]() {
+        // 任务在排队期间可能已被停止
+        if (task->isCancelled()) {
+            hlm_info("Task was cancelled before execution for key: {}.", task_key);
+            return;
+        }
         task->execute();
         taskCompleted(task, task_key);
-    }).detach();
+    });
+
+    if (!submitted) {
+        hlm_error("Failed to submit task to worker pool for key: {}", task_key);
+        releaseTask(task, task_key);
+    }
 }
 
 void HlmTaskManager::stopTask(shared_ptr<HlmTask> task) {
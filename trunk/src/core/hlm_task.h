@@ -2,6 +2,7 @@
 #define HLM_TASK_H
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <iostream>
 #include <memory>
@@ -12,6 +13,9 @@
 #include <vector>
 
 #include "hlm_mix_executor.h"
+#include "hlm_task_cost.h"
+#include "utils/hlm_config.h"
+#include "utils/hlm_thread_pool.h"
 
 using namespace std;
 
@@ -30,21 +34,33 @@ class HlmTask {
     const string& getMethod() const;
     void setCancelled(bool cancelled);
     bool isCancelled() const;
+    void setMediaProfile(const HlmMediaProfile& profile);
+    const HlmMediaProfile& getMediaProfile() const;
+    void setDecoderThreading(const HlmDecoderThreading& threading);
+    bool isLiveStream() const;
 
     virtual void execute() = 0;
     virtual void stop() = 0;
+    // 按任务类型、方法及媒体信息估算资源开销，用于准入控制
+    virtual HlmTaskCost estimateCost() const = 0;
+
+   protected:
+    HlmMediaProfile media_profile_;
+    HlmDecoderThreading decoder_threading_;  // 请求中指定的解码多线程设置
 
    private:
     TaskType type_;
     string stream_url_;
     string method_;
-    bool cancelled_;
+    atomic<bool> cancelled_;
 };
 
 namespace HlmTaskAction {
 const string Start = "start";
 const string Stop = "stop";
 const string Update = "update";
+const string Pin = "pin";
+const string Unpin = "unpin";
 }  // namespace HlmTaskAction
 
 enum class HlmTaskAddStatus {
@@ -56,17 +72,35 @@ enum class HlmTaskAddStatus {
     TaskNotFound         // 任务不存在
 };
 
-// HlmTaskManager 管理任务队列
+// 任务资源预算的使用情况
+struct HlmTaskBudgetUsage {
+    double cpu_used = 0.0;
+    double cpu_budget = 0.0;
+    int64_t memory_used_mb = 0;
+    int64_t memory_budget_mb = 0;
+    size_t active_tasks = 0;
+    size_t queued_tasks = 0;
+    int max_tasks = 0;
+};
+
+// HlmTaskManager 管理任务队列，按任务预估开销占用 CPU/内存预算进行准入
 class HlmTaskManager {
    public:
-    HlmTaskManager(int max_tasks);
+    HlmTaskManager(const TaskConfig& config);
+    ~HlmTaskManager();
 
     HlmTaskAddStatus addTask(shared_ptr<HlmTask> task, const string& streamUrl, const string& method);
     HlmTaskAddStatus updateTask(const string& streamUrl, const string& method, const HlmMixTaskParams& params);
     bool removeTask(const string& streamUrl, const string& method);
     void taskCompleted(shared_ptr<HlmTask> task, const string& task_key);
+    HlmThreadPoolStats getWorkerStats() const;
+    HlmTaskBudgetUsage getBudgetUsage() const;
 
    private:
+    bool canAdmit(const HlmTaskCost& cost) const;
+    void startTask(shared_ptr<HlmTask> task, const string& task_key, const HlmTaskCost& cost);
+    void releaseTask(shared_ptr<HlmTask> task, const string& task_key);
+    void scheduleQueuedTasks();
     void executeTask(shared_ptr<HlmTask> task, const string& task_key);
     void updateMixTask(shared_ptr<HlmTask> task, const HlmMixTaskParams& params);
     void stopTask(shared_ptr<HlmTask> task);
@@ -74,10 +108,15 @@ class HlmTaskManager {
 
     deque<shared_ptr<HlmTask>> task_queue_;
     vector<shared_ptr<HlmTask>> active_tasks_;
-    unordered_map<string, bool> active_task_keys_;
+    unordered_map<string, HlmTaskCost> active_task_costs_;
 
     int max_tasks_;
-    mutex mutex_;
+    double cpu_budget_;
+    int64_t memory_budget_mb_;
+    double cpu_used_ = 0.0;
+    int64_t memory_used_mb_ = 0;
+    mutable mutex mutex_;
+    HlmThreadPool worker_pool_;
 };
 
 #endif  // HLM_TASK_H
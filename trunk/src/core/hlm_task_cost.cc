@@ -0,0 +1,66 @@
+#include "hlm_task_cost.h"
+
+#include <algorithm>
+
+namespace {
+// 1080p H.264 实时解码约占用 1 核
+const double kReferencePixels = 1920.0 * 1080.0;
+const double kBaseDecodeCpu = 1.0;
+const double kBaseEncodeCpu = 2.0;
+const double kStreamCopyCpu = 0.05;
+const int64_t kBaseMemoryMb = 16;
+// 解码器帧线程及参考帧缓存的 YUV420 帧数
+const int64_t kDecodeBufferedFrames = 20;
+const int64_t kEncodeBufferedFrames = 40;
+
+double pixelFactor(const HlmMediaProfile& profile) {
+    if (profile.width <= 0 || profile.height <= 0) {
+        return 1.0;
+    }
+    return max(0.05, profile.width * static_cast<double>(profile.height) / kReferencePixels);
+}
+
+double codecFactor(const string& codec) {
+    if (codec == "hevc" || codec == "h265") return 1.8;
+    if (codec == "av1") return 2.5;
+    if (codec == "vp9") return 1.5;
+    if (codec == "mpeg4" || codec == "mpeg2video") return 0.6;
+    return 1.0;
+}
+
+int64_t frameMemoryMb(const HlmMediaProfile& profile, int64_t frames) {
+    int width = profile.width > 0 ? profile.width : 1920;
+    int height = profile.height > 0 ? profile.height : 1080;
+    int64_t frame_bytes = static_cast<int64_t>(width) * height * 3 / 2;
+    return frame_bytes * frames / (1024 * 1024);
+}
+}  // namespace
+
+namespace HlmTaskCostModel {
+
+HlmTaskCost decodeCost(const HlmMediaProfile& profile, double intensity) {
+    HlmTaskCost cost;
+    cost.cpu = kBaseDecodeCpu * pixelFactor(profile) * codecFactor(profile.codec) * intensity;
+    cost.memory_mb = kBaseMemoryMb + frameMemoryMb(profile, kDecodeBufferedFrames);
+    return cost;
+}
+
+HlmTaskCost encodeCost(const HlmMediaProfile& profile) {
+    HlmTaskCost cost;
+    cost.cpu = kBaseEncodeCpu * pixelFactor(profile) * codecFactor(profile.codec);
+    cost.memory_mb = kBaseMemoryMb + frameMemoryMb(profile, kEncodeBufferedFrames);
+    return cost;
+}
+
+HlmTaskCost streamCopyCost() {
+    HlmTaskCost cost;
+    cost.cpu = kStreamCopyCpu;
+    cost.memory_mb = kBaseMemoryMb;
+    return cost;
+}
+
+HlmTaskCost sum(const HlmTaskCost& a, const HlmTaskCost& b) {
+    return {a.cpu + b.cpu, a.memory_mb + b.memory_mb};
+}
+
+}  // namespace HlmTaskCostModel
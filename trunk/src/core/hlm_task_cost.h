@@ -0,0 +1,32 @@
+#ifndef HLM_TASK_COST_H
+#define HLM_TASK_COST_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// 任务预估资源开销，cpu 单位为核，memory_mb 单位为 MB
+struct HlmTaskCost {
+    double cpu = 0.0;
+    int64_t memory_mb = 0;
+};
+
+// 估算开销所需的媒体信息，请求未携带时按 1080p H.264 估算
+struct HlmMediaProfile {
+    int width = 1920;
+    int height = 1080;
+    string codec = "h264";
+};
+
+namespace HlmTaskCostModel {
+// 解码一路媒体的开销，intensity 为相对实时解码的倍数（文件解码不受实时速率限制）
+HlmTaskCost decodeCost(const HlmMediaProfile& profile, double intensity);
+// 编码一路视频的开销
+HlmTaskCost encodeCost(const HlmMediaProfile& profile);
+// 不解码直接转封装的开销
+HlmTaskCost streamCopyCost();
+HlmTaskCost sum(const HlmTaskCost& a, const HlmTaskCost& b);
+}  // namespace HlmTaskCostModel
+
+#endif  // HLM_TASK_COST_H
@@ -1,10 +1,22 @@
 #include "hlm_config.h"
 
 #include <iostream>
+#include <thread>
 #include <toml++/toml.hpp>
 
 HttpConfig Config::http_config;
 TaskConfig Config::task_config;
+ScreenshotConfig Config::screenshot_config;
+ArchiveConfig Config::archive_config;
+RecordingConfig Config::recording_config;
+InputPoolConfig Config::input_pool_config;
+CacheConfig Config::cache_config;
+CodecCacheConfig Config::codec_cache_config;
+WriterConfig Config::writer_config;
+IngestConfig Config::ingest_config;
+ReconnectConfig Config::reconnect_config;
+DecoderConfig Config::decoder_config;
+ProbeConfig Config::probe_config;
 LoggerConfig Config::logger_config;
 
 Config& Config::getInstance() {
@@ -22,6 +34,81 @@ void Config::load(const string& config_file) {
         // 读取Http配置
         auto& task_cfg = *config["task"].as_table();
         task_config.max_tasks = task_cfg["max_tasks"].value_or(3);
+        task_config.worker_threads = task_cfg["worker_threads"].value_or(task_config.max_tasks);
+        task_config.cpu_budget = task_cfg["cpu_budget"].value_or(0.0);
+        if (task_config.cpu_budget <= 0) {
+            task_config.cpu_budget = max(1u, thread::hardware_concurrency());
+        }
+        task_config.memory_budget_mb = task_cfg["memory_budget_mb"].value_or(int64_t(0));
+
+        // 读取截图配置
+        auto* screenshot_cfg = config["screenshot"].as_table();
+        screenshot_config.max_parallel_ranges = screenshot_cfg ? (*screenshot_cfg)["max_parallel_ranges"].value_or(4) : 4;
+        screenshot_config.image_format = screenshot_cfg ? (*screenshot_cfg)["image_format"].value_or("png") : "png";
+        screenshot_config.image_quality = screenshot_cfg ? (*screenshot_cfg)["image_quality"].value_or(85) : 85;
+
+        // 读取截图归档配置
+        auto* archive_cfg = config["archive"].as_table();
+        archive_config.max_pack_mb = archive_cfg ? (*archive_cfg)["max_pack_mb"].value_or(int64_t(256)) : 256;
+        archive_config.max_pack_seconds = archive_cfg ? (*archive_cfg)["max_pack_seconds"].value_or(int64_t(3600)) : 3600;
+
+        // 读取录制配置
+        auto* recording_cfg = config["recording"].as_table();
+        recording_config.fmp4_fragment_ms = recording_cfg ? (*recording_cfg)["fmp4_fragment_ms"].value_or(int64_t(2000)) : 2000;
+
+        // 读取输入池配置
+        auto* input_pool_cfg = config["input_pool"].as_table();
+        input_pool_config.enabled = input_pool_cfg ? (*input_pool_cfg)["enabled"].value_or(true) : true;
+        input_pool_config.idle_ttl_seconds = input_pool_cfg ? (*input_pool_cfg)["idle_ttl_seconds"].value_or(30) : 30;
+        input_pool_config.max_idle = input_pool_cfg ? (*input_pool_cfg)["max_idle"].value_or(16) : 16;
+
+        // 读取截图结果缓存配置
+        auto* cache_cfg = config["cache"].as_table();
+        cache_config.enabled = cache_cfg ? (*cache_cfg)["enabled"].value_or(true) : true;
+        cache_config.memory_max_mb = cache_cfg ? (*cache_cfg)["memory_max_mb"].value_or(int64_t(64)) : 64;
+        cache_config.disk_max_mb = cache_cfg ? (*cache_cfg)["disk_max_mb"].value_or(int64_t(1024)) : 1024;
+        cache_config.dir = cache_cfg ? (*cache_cfg)["dir"].value_or("./cache/screenshot") : "./cache/screenshot";
+
+        // 读取缩放和编码上下文缓存配置
+        auto* codec_cache_cfg = config["codec_cache"].as_table();
+        codec_cache_config.enabled = codec_cache_cfg ? (*codec_cache_cfg)["enabled"].value_or(true) : true;
+        codec_cache_config.max_idle_per_key = codec_cache_cfg ? (*codec_cache_cfg)["max_idle_per_key"].value_or(4) : 4;
+
+        // 读取文件写入配置
+        auto* writer_cfg = config["writer"].as_table();
+        writer_config.threads = writer_cfg ? (*writer_cfg)["threads"].value_or(4) : 4;
+        writer_config.task_backlog_mb = writer_cfg ? (*writer_cfg)["task_backlog_mb"].value_or(int64_t(64)) : 64;
+
+        // 读取拉流配置
+        auto* ingest_cfg = config["ingest"].as_table();
+        ingest_config.shared = ingest_cfg ? (*ingest_cfg)["shared"].value_or(true) : true;
+        ingest_config.gop_cache_max_mb = ingest_cfg ? (*ingest_cfg)["gop_cache_max_mb"].value_or(int64_t(16)) : 16;
+
+        // 读取断流重连配置
+        auto* reconnect_cfg = config["reconnect"].as_table();
+        reconnect_config.read_timeout_ms = reconnect_cfg ? (*reconnect_cfg)["read_timeout_ms"].value_or(int64_t(3000)) : 3000;
+        reconnect_config.max_retries = reconnect_cfg ? (*reconnect_cfg)["max_retries"].value_or(5) : 5;
+        reconnect_config.backoff_initial_ms = reconnect_cfg ? (*reconnect_cfg)["backoff_initial_ms"].value_or(int64_t(200)) : 200;
+        reconnect_config.backoff_max_ms = reconnect_cfg ? (*reconnect_cfg)["backoff_max_ms"].value_or(int64_t(5000)) : 5000;
+
+        // 读取解码配置
+        auto* decoder_cfg = config["decoder"].as_table();
+        decoder_config.thread_type = decoder_cfg ? (*decoder_cfg)["thread_type"].value_or("auto") : "auto";
+        decoder_config.threads = decoder_cfg ? (*decoder_cfg)["threads"].value_or(0) : 0;
+        decoder_config.max_threads = decoder_cfg ? (*decoder_cfg)["max_threads"].value_or(16) : 16;
+
+        // 读取流信息探测配置，各任务类型未配置时使用通用的探测参数
+        auto* probe_cfg = config["probe"].as_table();
+        probe_config.cache_enabled = probe_cfg ? (*probe_cfg)["cache_enabled"].value_or(true) : true;
+        probe_config.cache_max_entries = probe_cfg ? (*probe_cfg)["cache_max_entries"].value_or(256) : 256;
+        probe_config.cached.probesize = probe_cfg ? (*probe_cfg)["cached_probesize"].value_or(int64_t(32768)) : 32768;
+        probe_config.cached.analyzeduration_ms = probe_cfg ? (*probe_cfg)["cached_analyzeduration_ms"].value_or(int64_t(100)) : 100;
+        probe_config.defaults.probesize = probe_cfg ? (*probe_cfg)["probesize"].value_or(int64_t(5000000)) : 5000000;
+        probe_config.defaults.analyzeduration_ms = probe_cfg ? (*probe_cfg)["analyzeduration_ms"].value_or(int64_t(5000)) : 5000;
+        probe_config.screenshot.probesize = probe_cfg ? (*probe_cfg)["screenshot_probesize"].value_or(probe_config.defaults.probesize) : probe_config.defaults.probesize;
+        probe_config.screenshot.analyzeduration_ms = probe_cfg ? (*probe_cfg)["screenshot_analyzeduration_ms"].value_or(probe_config.defaults.analyzeduration_ms) : probe_config.defaults.analyzeduration_ms;
+        probe_config.recording.probesize = probe_cfg ? (*probe_cfg)["recording_probesize"].value_or(probe_config.defaults.probesize) : probe_config.defaults.probesize;
+        probe_config.recording.analyzeduration_ms = probe_cfg ? (*probe_cfg)["recording_analyzeduration_ms"].value_or(probe_config.defaults.analyzeduration_ms) : probe_config.defaults.analyzeduration_ms;
 
         // 读取日志配置
         auto& logger_cfg = *config["logger"].as_table();
@@ -58,7 +145,49 @@ void Config::printAllConfigs() const {
     hlm_info("Http Configurations: Port: {}", http_config.port);
 
     // 打印Http配置
-    hlm_info("Task Configurations: Max Tasks: {}", task_config.max_tasks);
+    hlm_info("Task Configurations: Max Tasks: {}, Worker Threads: {}, CPU Budget: {}, Memory Budget: {}MB",
+             task_config.max_tasks, task_config.worker_threads, task_config.cpu_budget, task_config.memory_budget_mb);
+
+    // 打印截图配置
+    hlm_info("Screenshot Configurations: Max Parallel Ranges: {}, Image Format: {}, Image Quality: {}",
+             screenshot_config.max_parallel_ranges, screenshot_config.image_format, screenshot_config.image_quality);
+
+    // 打印截图归档配置
+    hlm_info("Archive Configurations: Max Pack Size: {}MB, Max Pack Seconds: {}", archive_config.max_pack_mb, archive_config.max_pack_seconds);
+
+    // 打印录制配置
+    hlm_info("Recording Configurations: FMP4 Fragment Duration: {}ms", recording_config.fmp4_fragment_ms);
+
+    // 打印输入池配置
+    hlm_info("Input Pool Configurations: Enabled: {}, Idle TTL: {}s, Max Idle: {}",
+             input_pool_config.enabled, input_pool_config.idle_ttl_seconds, input_pool_config.max_idle);
+
+    // 打印截图结果缓存配置
+    hlm_info("Cache Configurations: Enabled: {}, Memory Max Size: {}MB, Disk Max Size: {}MB, Dir: {}",
+             cache_config.enabled, cache_config.memory_max_mb, cache_config.disk_max_mb, cache_config.dir);
+
+    // 打印缩放和编码上下文缓存配置
+    hlm_info("Codec Cache Configurations: Enabled: {}, Max Idle Per Key: {}", codec_cache_config.enabled, codec_cache_config.max_idle_per_key);
+
+    // 打印文件写入配置
+    hlm_info("Writer Configurations: Threads: {}, Task Backlog: {}MB", writer_config.threads, writer_config.task_backlog_mb);
+
+    // 打印拉流配置
+    hlm_info("Ingest Configurations: Shared: {}, GOP Cache Max Size: {}MB", ingest_config.shared, ingest_config.gop_cache_max_mb);
+
+    // 打印断流重连配置
+    hlm_info("Reconnect Configurations: Read Timeout: {}ms, Max Retries: {}, Backoff: {}ms - {}ms",
+             reconnect_config.read_timeout_ms, reconnect_config.max_retries, reconnect_config.backoff_initial_ms, reconnect_config.backoff_max_ms);
+
+    // 打印解码配置
+    hlm_info("Decoder Configurations: Thread Type: {}, Threads: {}, Max Threads: {}",
+             decoder_config.thread_type, decoder_config.threads, decoder_config.max_threads);
+
+    // 打印流信息探测配置
+    hlm_info("Probe Configurations: Cache Enabled: {}, Cache Max Entries: {}, Cached: {}B/{}ms, Default: {}B/{}ms, Screenshot: {}B/{}ms, Recording: {}B/{}ms",
+             probe_config.cache_enabled, probe_config.cache_max_entries, probe_config.cached.probesize, probe_config.cached.analyzeduration_ms,
+             probe_config.defaults.probesize, probe_config.defaults.analyzeduration_ms, probe_config.screenshot.probesize, probe_config.screenshot.analyzeduration_ms,
+             probe_config.recording.probesize, probe_config.recording.analyzeduration_ms);
 
     // 打印日志配置
     hlm_info("Logger Configurations: Level: {}, Target: {}, Dir: {}, Base Name: {}, Use Async: {}, Max File Size: {}, Max Files: {}",
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include "hlm_logger.h"
@@ -15,6 +16,79 @@ struct HttpConfig {
 
 struct TaskConfig {
     int max_tasks;
+    int worker_threads;
+    double cpu_budget;
+    int64_t memory_budget_mb;
+};
+
+struct ScreenshotConfig {
+    int max_parallel_ranges;
+    std::string image_format;
+    int image_quality;
+};
+
+struct ArchiveConfig {
+    int64_t max_pack_mb;
+    int64_t max_pack_seconds;
+};
+
+struct RecordingConfig {
+    int64_t fmp4_fragment_ms;
+};
+
+struct InputPoolConfig {
+    bool enabled;
+    int idle_ttl_seconds;
+    int max_idle;
+};
+
+struct CacheConfig {
+    bool enabled;
+    int64_t memory_max_mb;
+    int64_t disk_max_mb;
+    std::string dir;
+};
+
+struct CodecCacheConfig {
+    bool enabled;
+    int max_idle_per_key;
+};
+
+struct WriterConfig {
+    int threads;
+    int64_t task_backlog_mb;
+};
+
+struct IngestConfig {
+    bool shared;
+    int64_t gop_cache_max_mb;
+};
+
+struct ReconnectConfig {
+    int64_t read_timeout_ms;
+    int max_retries;
+    int64_t backoff_initial_ms;
+    int64_t backoff_max_ms;
+};
+
+struct DecoderConfig {
+    std::string thread_type;
+    int threads;
+    int max_threads;
+};
+
+struct ProbeSettings {
+    int64_t probesize;
+    int64_t analyzeduration_ms;
+};
+
+struct ProbeConfig {
+    bool cache_enabled;
+    int cache_max_entries;
+    ProbeSettings cached;
+    ProbeSettings defaults;
+    ProbeSettings screenshot;
+    ProbeSettings recording;
 };
 
 struct LoggerConfig {
@@ -54,6 +128,63 @@ class Config {
 
     // Task Config Accessors
     const int getMaxTasks() const { return task_config.max_tasks; }
+    const int getWorkerThreads() const { return task_config.worker_threads; }
+    const TaskConfig& getTaskConfig() const { return task_config; }
+    double getCpuBudget() const { return task_config.cpu_budget; }
+
+    // Screenshot Config Accessors
+    int getMaxParallelRanges() const { return screenshot_config.max_parallel_ranges; }
+    const std::string& getImageFormat() const { return screenshot_config.image_format; }
+    int getImageQuality() const { return screenshot_config.image_quality; }
+
+    // Archive Config Accessors
+    int64_t getArchiveMaxPackBytes() const { return archive_config.max_pack_mb * 1024 * 1024; }
+    int64_t getArchiveMaxPackSeconds() const { return archive_config.max_pack_seconds; }
+
+    // Recording Config Accessors
+    int64_t getFmp4FragmentUs() const { return recording_config.fmp4_fragment_ms * 1000; }
+
+    // Input Pool Config Accessors
+    bool isInputPoolEnabled() const { return input_pool_config.enabled; }
+    int64_t getInputPoolIdleTtlUs() const { return int64_t(input_pool_config.idle_ttl_seconds) * 1000000; }
+    int getInputPoolMaxIdle() const { return input_pool_config.max_idle; }
+
+    // Cache Config Accessors
+    bool isResultCacheEnabled() const { return cache_config.enabled; }
+    int64_t getCacheMemoryMaxBytes() const { return cache_config.memory_max_mb * 1024 * 1024; }
+    int64_t getCacheDiskMaxBytes() const { return cache_config.disk_max_mb * 1024 * 1024; }
+    const std::string& getCacheDir() const { return cache_config.dir; }
+
+    // Codec Cache Config Accessors
+    bool isCodecCacheEnabled() const { return codec_cache_config.enabled; }
+    int getCodecCacheMaxIdlePerKey() const { return codec_cache_config.max_idle_per_key; }
+
+    // Writer Config Accessors
+    int getWriterThreads() const { return writer_config.threads; }
+    int64_t getWriterTaskBacklogBytes() const { return writer_config.task_backlog_mb * 1024 * 1024; }
+
+    // Ingest Config Accessors
+    bool isSharedIngestEnabled() const { return ingest_config.shared; }
+    int64_t getGopCacheMaxBytes() const { return ingest_config.gop_cache_max_mb * 1024 * 1024; }
+
+    // Reconnect Config Accessors
+    int64_t getReadTimeoutUs() const { return reconnect_config.read_timeout_ms * 1000; }
+    int getReconnectMaxRetries() const { return reconnect_config.max_retries; }
+    int64_t getReconnectBackoffInitialMs() const { return reconnect_config.backoff_initial_ms; }
+    int64_t getReconnectBackoffMaxMs() const { return reconnect_config.backoff_max_ms; }
+
+    // Decoder Config Accessors
+    const std::string& getDecoderThreadType() const { return decoder_config.thread_type; }
+    int getDecoderThreads() const { return decoder_config.threads; }
+    int getDecoderMaxThreads() const { return decoder_config.max_threads; }
+
+    // Probe Config Accessors
+    bool isProbeCacheEnabled() const { return probe_config.cache_enabled; }
+    int getProbeCacheMaxEntries() const { return probe_config.cache_max_entries; }
+    const ProbeSettings& getCachedProbe() const { return probe_config.cached; }
+    const ProbeSettings& getDefaultProbe() const { return probe_config.defaults; }
+    const ProbeSettings& getScreenshotProbe() const { return probe_config.screenshot; }
+    const ProbeSettings& getRecordingProbe() const { return probe_config.recording; }
 
     // Logger Config Accessors
     Logger::LogLevel getLogLevel() const { return parseLogLevel(logger_config.level); }
@@ -75,6 +206,17 @@ class Config {
 
     static HttpConfig http_config;
     static TaskConfig task_config;
+    static ScreenshotConfig screenshot_config;
+    static ArchiveConfig archive_config;
+    static RecordingConfig recording_config;
+    static InputPoolConfig input_pool_config;
+    static CacheConfig cache_config;
+    static CodecCacheConfig codec_cache_config;
+    static WriterConfig writer_config;
+    static IngestConfig ingest_config;
+    static ReconnectConfig reconnect_config;
+    static DecoderConfig decoder_config;
+    static ProbeConfig probe_config;
     static LoggerConfig logger_config;
 
     static Logger::LogLevel parseLogLevel(const std::string& level_str);
@@ -1,6 +1,7 @@
 #ifndef HLMQUEUE_H
 #define HLMQUEUE_H
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -10,6 +11,7 @@ class HlmQueue {
    public:
     void push(T value);
     T pop();
+    bool tryPop(T& value, int64_t timeout_ms);
     bool empty() const;
     size_t size() const;
 
@@ -35,6 +37,17 @@ T HlmQueue<T>::pop() {
     return value;
 }
 
+template <typename T>
+bool HlmQueue<T>::tryPop(T& value, int64_t timeout_ms) {
+    unique_lock<mutex> lock(mutex_);
+    if (!cond_var_.wait_for(lock, chrono::milliseconds(timeout_ms), [this]() { return !queue_.empty(); })) {
+        return false;
+    }
+    value = move(queue_.front());
+    queue_.pop();
+    return true;
+}
+
 template <typename T>
 bool HlmQueue<T>::empty() const {
     lock_guard<mutex> lock(mutex_);
@@ -0,0 +1,195 @@
+#include "hlm_simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HLM_SIMD_X86 1
+#endif
+
+enum class HlmSimdLevel {
+    Scalar,
+    Sse,
+    Avx2
+};
+
+static HlmSimdLevel detectSimdLevel() {
+#ifdef HLM_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return HlmSimdLevel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return HlmSimdLevel::Sse;
+    }
+#endif
+    return HlmSimdLevel::Scalar;
+}
+
+static HlmSimdLevel simdLevel() {
+    static const HlmSimdLevel level = detectSimdLevel();
+    return level;
+}
+
+const char* hlmSimdLevel() {
+    switch (simdLevel()) {
+        case HlmSimdLevel::Avx2:
+            return "avx2";
+        case HlmSimdLevel::Sse:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
+
+static uint64_t sumAbsDiffScalar(const uint8_t* a, const uint8_t* b, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    }
+    return sum;
+}
+
+#ifdef HLM_SIMD_X86
+__attribute__((target("sse4.1"))) static uint64_t sumAbsDiffSse(const uint8_t* a, const uint8_t* b, size_t size) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    uint64_t sum = static_cast<uint64_t>(_mm_extract_epi64(acc, 0)) + static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return sum + sumAbsDiffScalar(a + i, b + i, size - i);
+}
+
+__attribute__((target("avx2"))) static uint64_t sumAbsDiffAvx2(const uint8_t* a, const uint8_t* b, size_t size) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return sum + sumAbsDiffScalar(a + i, b + i, size - i);
+}
+#endif
+
+uint64_t hlmSumAbsDiff(const uint8_t* a, const uint8_t* b, size_t size) {
+#ifdef HLM_SIMD_X86
+    switch (simdLevel()) {
+        case HlmSimdLevel::Avx2:
+            return sumAbsDiffAvx2(a, b, size);
+        case HlmSimdLevel::Sse:
+            return sumAbsDiffSse(a, b, size);
+        default:
+            break;
+    }
+#endif
+    return sumAbsDiffScalar(a, b, size);
+}
+
+// 拉普拉斯响应的和与平方和，按行分段累加，每段的 32 位累加不会溢出
+struct LaplacianSums {
+    int64_t sum = 0;
+    uint64_t sum_sq = 0;
+};
+
+static const int LAPLACIAN_CHUNK = 4096;
+
+static void laplacianRowScalar(const uint8_t* up, const uint8_t* cur, const uint8_t* down, int begin, int end, LaplacianSums& sums) {
+    for (int x = begin; x < end; x++) {
+        int laplacian = 4 * cur[x] - cur[x - 1] - cur[x + 1] - up[x] - down[x];
+        sums.sum += laplacian;
+        sums.sum_sq += static_cast<uint64_t>(laplacian * laplacian);
+    }
+}
+
+#ifdef HLM_SIMD_X86
+__attribute__((target("sse4.1"))) static int laplacianRowSse(const uint8_t* up, const uint8_t* cur, const uint8_t* down, int begin, int end, LaplacianSums& sums) {
+    const __m128i ones = _mm_set1_epi16(1);
+    int x = begin;
+    while (x + 8 <= end) {
+        __m128i acc = _mm_setzero_si128();
+        __m128i acc_sq = _mm_setzero_si128();
+        int chunk_end = min(end, x + LAPLACIAN_CHUNK);
+        for (; x + 8 <= chunk_end; x += 8) {
+            __m128i c = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cur + x)));
+            __m128i l = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cur + x - 1)));
+            __m128i r = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cur + x + 1)));
+            __m128i u = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(up + x)));
+            __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(down + x)));
+            __m128i laplacian = _mm_sub_epi16(_mm_slli_epi16(c, 2), _mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(u, d)));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(laplacian, ones));
+            acc_sq = _mm_add_epi32(acc_sq, _mm_madd_epi16(laplacian, laplacian));
+        }
+        int32_t lanes[4];
+        uint32_t lanes_sq[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes_sq), acc_sq);
+        for (int i = 0; i < 4; i++) {
+            sums.sum += lanes[i];
+            sums.sum_sq += lanes_sq[i];
+        }
+    }
+    return x;
+}
+
+__attribute__((target("avx2"))) static int laplacianRowAvx2(const uint8_t* up, const uint8_t* cur, const uint8_t* down, int begin, int end, LaplacianSums& sums) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int x = begin;
+    while (x + 16 <= end) {
+        __m256i acc = _mm256_setzero_si256();
+        __m256i acc_sq = _mm256_setzero_si256();
+        int chunk_end = min(end, x + LAPLACIAN_CHUNK);
+        for (; x + 16 <= chunk_end; x += 16) {
+            __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + x)));
+            __m256i l = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + x - 1)));
+            __m256i r = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + x + 1)));
+            __m256i u = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x)));
+            __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(down + x)));
+            __m256i laplacian = _mm256_sub_epi16(_mm256_slli_epi16(c, 2), _mm256_add_epi16(_mm256_add_epi16(l, r), _mm256_add_epi16(u, d)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(laplacian, ones));
+            acc_sq = _mm256_add_epi32(acc_sq, _mm256_madd_epi16(laplacian, laplacian));
+        }
+        int32_t lanes[8];
+        uint32_t lanes_sq[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes_sq), acc_sq);
+        for (int i = 0; i < 8; i++) {
+            sums.sum += lanes[i];
+            sums.sum_sq += lanes_sq[i];
+        }
+    }
+    return x;
+}
+#endif
+
+double hlmLaplacianVariance(const uint8_t* plane, ptrdiff_t linesize, int width, int height) {
+    if (width < 3 || height < 3) {
+        return 0;
+    }
+
+    LaplacianSums sums;
+    HlmSimdLevel level = simdLevel();
+    for (int y = 1; y < height - 1; y++) {
+        const uint8_t* cur = plane + y * linesize;
+        int x = 1;
+#ifdef HLM_SIMD_X86
+        if (level == HlmSimdLevel::Avx2) {
+            x = laplacianRowAvx2(cur - linesize, cur, cur + linesize, x, width - 1, sums);
+        } else if (level == HlmSimdLevel::Sse) {
+            x = laplacianRowSse(cur - linesize, cur, cur + linesize, x, width - 1, sums);
+        }
+#endif
+        laplacianRowScalar(cur - linesize, cur, cur + linesize, x, width - 1, sums);
+    }
+
+    double count = static_cast<double>(width - 2) * (height - 2);
+    double mean = sums.sum / count;
+    return sums.sum_sq / count - mean * mean;
+}
@@ -0,0 +1,20 @@
+#ifndef HLM_SIMD_H
+#define HLM_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// 图像分析用的 SIMD 计算函数，运行时按 CPU 支持的指令集选择 AVX2、SSE 或标量实现
+
+// 两个 8 位平面逐像素差的绝对值之和
+uint64_t hlmSumAbsDiff(const uint8_t* a, const uint8_t* b, size_t size);
+
+// 8 位平面的拉普拉斯响应（4 邻域）方差，越大画面越清晰，边缘一圈像素不参与计算
+double hlmLaplacianVariance(const uint8_t* plane, ptrdiff_t linesize, int width, int height);
+
+// 当前 CPU 使用的指令集名称
+const char* hlmSimdLevel();
+
+#endif  // HLM_SIMD_H
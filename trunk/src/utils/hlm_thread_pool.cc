@@ -0,0 +1,99 @@
+#include "hlm_thread_pool.h"
+
+#include <algorithm>
+
+#include "hlm_logger.h"
+#include "hlm_time.h"
+
+HlmThreadPool::HlmThreadPool(const string& name, size_t thread_count)
+    : name_(name), thread_count_(max<size_t>(thread_count, 1)) {
+    workers_.reserve(thread_count_);
+    for (size_t i = 0; i < thread_count_; i++) {
+        workers_.emplace_back(&HlmThreadPool::workerLoop, this, i);
+    }
+    hlm_info("Thread pool {} started with {} workers", name_, thread_count_);
+}
+
+HlmThreadPool::~HlmThreadPool() {
+    shutdown();
+}
+
+bool HlmThreadPool::submit(function<void()> job) {
+    lock_guard<mutex> lock(mutex_);
+    if (stopping_) {
+        hlm_warn("Thread pool {} is shutting down, rejecting job.", name_);
+        return false;
+    }
+
+    jobs_.push_back({move(job), getCurrentTimeInMicroseconds()});
+    cond_var_.notify_one();
+    return true;
+}
+
+void HlmThreadPool::shutdown() {
+    size_t dropped_jobs = 0;
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        dropped_jobs = jobs_.size();
+        jobs_.clear();
+    }
+    cond_var_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    hlm_info("Thread pool {} stopped. Dropped {} queued jobs.", name_, dropped_jobs);
+}
+
+HlmThreadPoolStats HlmThreadPool::getStats() const {
+    lock_guard<mutex> lock(mutex_);
+    HlmThreadPoolStats stats;
+    stats.workers = thread_count_;
+    stats.busy_workers = busy_workers_;
+    stats.queued_jobs = jobs_.size();
+    stats.started_jobs = started_jobs_;
+    stats.last_wait_us = last_wait_us_;
+    stats.avg_wait_us = started_jobs_ > 0 ? total_wait_us_ / static_cast<int64_t>(started_jobs_) : 0;
+    stats.max_wait_us = max_wait_us_;
+    return stats;
+}
+
+void HlmThreadPool::workerLoop(size_t worker_index) {
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(mutex_);
+            cond_var_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                break;
+            }
+
+            job = move(jobs_.front());
+            jobs_.pop_front();
+
+            int64_t wait_us = getCurrentTimeInMicroseconds() - job.enqueue_time;
+            busy_workers_++;
+            started_jobs_++;
+            total_wait_us_ += wait_us;
+            last_wait_us_ = wait_us;
+            max_wait_us_ = max(max_wait_us_, wait_us);
+            hlm_debug("Thread pool {} worker {} picked up job after waiting {}µs. Busy workers: {}/{}, queued jobs: {}",
+                      name_, worker_index, wait_us, busy_workers_, thread_count_, jobs_.size());
+        }
+
+        try {
+            job.func();
+        } catch (const exception& e) {
+            hlm_error("Thread pool {} worker {} job threw exception: {}", name_, worker_index, e.what());
+        }
+
+        lock_guard<mutex> lock(mutex_);
+        busy_workers_--;
+    }
+}
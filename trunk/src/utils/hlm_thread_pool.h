@@ -0,0 +1,58 @@
+#ifndef HLM_THREAD_POOL_H
+#define HLM_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct HlmThreadPoolStats {
+    size_t workers = 0;          // 工作线程数
+    size_t busy_workers = 0;     // 正在执行任务的线程数
+    size_t queued_jobs = 0;      // 排队等待的任务数
+    uint64_t started_jobs = 0;   // 已开始执行的任务总数
+    int64_t last_wait_us = 0;    // 最近一个任务的排队等待时间，单位：微秒
+    int64_t avg_wait_us = 0;     // 平均排队等待时间，单位：微秒
+    int64_t max_wait_us = 0;     // 最大排队等待时间，单位：微秒
+};
+
+// 固定大小的工作线程池，提交的任务在队列中等待空闲线程执行
+class HlmThreadPool {
+   public:
+    HlmThreadPool(const string& name, size_t thread_count);
+    ~HlmThreadPool();
+
+    bool submit(function<void()> job);
+    void shutdown();
+    HlmThreadPoolStats getStats() const;
+
+   private:
+    struct Job {
+        function<void()> func;
+        int64_t enqueue_time;
+    };
+
+    void workerLoop(size_t worker_index);
+
+    string name_;
+    size_t thread_count_;
+    vector<thread> workers_;
+    deque<Job> jobs_;
+    mutable mutex mutex_;
+    condition_variable cond_var_;
+    bool stopping_ = false;
+
+    size_t busy_workers_ = 0;
+    uint64_t started_jobs_ = 0;
+    int64_t total_wait_us_ = 0;
+    int64_t last_wait_us_ = 0;
+    int64_t max_wait_us_ = 0;
+};
+
+#endif  // HLM_THREAD_POOL_H